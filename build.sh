@@ -5,9 +5,12 @@ set -xeuo pipefail
 gcc \
   -Wall \
   -Wextra \
+  -O2 \
   -I./raylib-5.5_linux_amd64/include \
   -o main \
   main.c \
   -L./raylib-5.5_linux_amd64/lib \
   -lraylib \
+  -lz \
+  -lpthread \
   -lm
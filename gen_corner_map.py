@@ -1,6 +1,66 @@
-encoding = ['A', 'C', 'G', 'T', 'a', 'c', 'g', 't']
-rest = set(chr(n) for n in range(0, 256)) - set(encoding)
-encoding += sorted(rest)
+# prints the byte_class, protein_class, alphabet_corners and alphabet_labels
+# tables of main.c; bytes not listed are CGR_CLASS_OTHER (or not a residue)
+bases = {'A': 'CGR_CLASS_A', 'C': 'CGR_CLASS_C', 'G': 'CGR_CLASS_G',
+         'T': 'CGR_CLASS_T', 'U': 'CGR_CLASS_T', 'N': 'CGR_CLASS_N'}
+for n in 'RYSWKMBDHV':
+    bases[n] = 'CGR_CLASS_IUPAC'
 
-for i, n in enumerate(encoding):
-    print(f'[{ord(n):3d}] = {i%4},')
+# X is an unknown residue like N is an unknown base; B, Z and J are
+# ambiguous and U, O rare, they go through the IUPAC policy
+residues = {'X': 'CGR_CLASS_N'}
+for n in 'BZJUO':
+    residues[n] = 'CGR_CLASS_IUPAC'
+
+# one group of residues per corner, corners counter-clockwise from the top
+alphabets = {
+    'ALPHABET_PROTEIN': list('ACDEFGHIKLMNPQRSTVWY'),
+    # Dayhoff, 1978
+    'ALPHABET_DAYHOFF6': ['AGPST', 'C', 'DENQ', 'FWY', 'HKR', 'ILMV'],
+    # Murphy, Wallqvist and Levy, 2000
+    'ALPHABET_MURPHY10': ['LVIM', 'C', 'A', 'G', 'ST', 'P', 'FYW', 'EDNQ',
+                          'KR', 'H'],
+}
+
+
+def both_cases(table):
+    entries = {}
+    for n, v in table.items():
+        entries[ord(n)] = v
+        entries[ord(n.lower())] = v
+    return sorted(entries.items())
+
+
+def print_entries(entries, indent):
+    entries = [f'[{n:3d}] = {v},' for n, v in entries]
+    for i in range(0, len(entries), 4):
+        print(indent + ' '.join(entries[i:i + 4]))
+
+
+print('static const uint8_t byte_class[256] = {')
+print_entries(both_cases(bases), '  ')
+print('};')
+print()
+print('static const uint8_t protein_class[256] = {')
+print_entries(both_cases(residues), '  ')
+print('};')
+print()
+print('static const uint8_t alphabet_corners[ALPHABET_COUNT][256] = {')
+for name, groups in alphabets.items():
+    corners = {r: i + 1 for i, g in enumerate(groups) for r in g}
+    print(f'  [{name}] = {{')
+    print_entries(both_cases(corners), '    ')
+    print('  },')
+print('};')
+print()
+print('static char* alphabet_labels[ALPHABET_COUNT][CORNERS_MAX] = {')
+for name, groups in alphabets.items():
+    labels = ', '.join(f'"{g}"' for g in groups)
+    line = f'  [{name}] = {{{labels}}},'
+    if len(line) <= 80:
+        print(line)
+        continue
+    print(f'  [{name}] = {{')
+    for i in range(0, len(groups), 10):
+        print('    ' + ', '.join(f'"{g}"' for g in groups[i:i + 10]) + ',')
+    print('  },')
+print('};')
@@ -1,18 +1,28 @@
+#define _GNU_SOURCE
+
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <immintrin.h>
+#include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <zlib.h>
+
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 
 #define WINDOW_W 1000
 #define WINDOW_H WINDOW_W
@@ -20,263 +30,3851 @@
 #define GRID_W 800
 #define GRID_H GRID_W
 #define GRID_N 400
-#define GRID_PIXELS_PER_CELL ((float)GRID_W / GRID_N)
+#define GRID_N_MAX 8192
 
 #define VIS_STEPS_PER_ITER 100000
+#define VIS_STEPS_MIN 4096
+#define VIS_STEPS_MAX (1 << 28)
+
+#define SAMPLE_READAHEAD (64 << 20)
+#define SAMPLE_STREAM_CHUNK (4 << 20)
+
+#define GZIP_IN_CHUNK (1 << 20)
+#define BGZF_HEADER_LEN 18
+#define BGZF_BLOCK_MAX 65536
+#define BGZF_BATCH_BLOCKS 128
+
+#define TWOBIT_MAGIC 0x1A412743
+
+// DNA walks the unit square, one base per corner; protein alphabets walk a
+// regular polygon with one corner per amino acid or group of them
+#define DNA_CORNERS 4
+#define CORNERS_MAX 20
+
+enum {
+  ALPHABET_DNA = 0,
+  ALPHABET_PROTEIN,
+  ALPHABET_DAYHOFF6,
+  ALPHABET_MURPHY10,
+  ALPHABET_COUNT,
+};
+
+static char* alphabet_names[ALPHABET_COUNT] = {
+  [ALPHABET_DNA] = "dna",
+  [ALPHABET_PROTEIN] = "protein",
+  [ALPHABET_DAYHOFF6] = "dayhoff6",
+  [ALPHABET_MURPHY10] = "murphy10",
+};
+
+static const int32_t alphabet_n_corners[ALPHABET_COUNT] = {
+  [ALPHABET_DNA] = DNA_CORNERS,
+  [ALPHABET_PROTEIN] = 20,
+  [ALPHABET_DAYHOFF6] = 6,
+  [ALPHABET_MURPHY10] = 10,
+};
+
+static int32_t alphabet = ALPHABET_DNA;
+static int32_t n_corners = DNA_CORNERS;
+static Vector2 corner_pos[CORNERS_MAX] = {0};
+
+enum {
+  CGR_CLASS_OTHER = 0,
+  CGR_CLASS_A,
+  CGR_CLASS_C,
+  CGR_CLASS_G,
+  CGR_CLASS_T,
+  CGR_CLASS_N,
+  CGR_CLASS_IUPAC,
+  CGR_CLASS_COUNT,
+};
+
+// what happens to a byte that is not a base, see cgr_init_corner_map
+enum {
+  CGR_POLICY_SKIP = 0,
+  CGR_POLICY_RESTART,
+  CGR_POLICY_MASK,
+  CGR_POLICY_COUNT,
+};
+
+static char* policy_names[CGR_POLICY_COUNT] = {
+  [CGR_POLICY_SKIP] = "skip",
+  [CGR_POLICY_RESTART] = "restart",
+  [CGR_POLICY_MASK] = "mask",
+};
+
+// corner_map values past the corners
+#define CORNER_SKIP (CORNERS_MAX + CGR_POLICY_SKIP)
+#define CORNER_RESTART (CORNERS_MAX + CGR_POLICY_RESTART)
+#define CORNER_MASK (CORNERS_MAX + CGR_POLICY_MASK)
+
+// generated by gen_corner_map.py
+static const uint8_t byte_class[256] = {
+  [ 65] = CGR_CLASS_A, [ 66] = CGR_CLASS_IUPAC, [ 67] = CGR_CLASS_C, [ 68] = CGR_CLASS_IUPAC,
+  [ 71] = CGR_CLASS_G, [ 72] = CGR_CLASS_IUPAC, [ 75] = CGR_CLASS_IUPAC, [ 77] = CGR_CLASS_IUPAC,
+  [ 78] = CGR_CLASS_N, [ 82] = CGR_CLASS_IUPAC, [ 83] = CGR_CLASS_IUPAC, [ 84] = CGR_CLASS_T,
+  [ 85] = CGR_CLASS_T, [ 86] = CGR_CLASS_IUPAC, [ 87] = CGR_CLASS_IUPAC, [ 89] = CGR_CLASS_IUPAC,
+  [ 97] = CGR_CLASS_A, [ 98] = CGR_CLASS_IUPAC, [ 99] = CGR_CLASS_C, [100] = CGR_CLASS_IUPAC,
+  [103] = CGR_CLASS_G, [104] = CGR_CLASS_IUPAC, [107] = CGR_CLASS_IUPAC, [109] = CGR_CLASS_IUPAC,
+  [110] = CGR_CLASS_N, [114] = CGR_CLASS_IUPAC, [115] = CGR_CLASS_IUPAC, [116] = CGR_CLASS_T,
+  [117] = CGR_CLASS_T, [118] = CGR_CLASS_IUPAC, [119] = CGR_CLASS_IUPAC, [121] = CGR_CLASS_IUPAC,
+};
+
+// protein bytes go to corner - 1 of their alphabet, X takes the N policy
+// and the ambiguous and rare residues (B, Z, J, U, O) the IUPAC one
+static const uint8_t protein_class[256] = {
+  [ 66] = CGR_CLASS_IUPAC, [ 74] = CGR_CLASS_IUPAC, [ 79] = CGR_CLASS_IUPAC, [ 85] = CGR_CLASS_IUPAC,
+  [ 88] = CGR_CLASS_N, [ 90] = CGR_CLASS_IUPAC, [ 98] = CGR_CLASS_IUPAC, [106] = CGR_CLASS_IUPAC,
+  [111] = CGR_CLASS_IUPAC, [117] = CGR_CLASS_IUPAC, [120] = CGR_CLASS_N, [122] = CGR_CLASS_IUPAC,
+};
 
-#define N_CORNERS 4
-
-static Vector2 corner_pos[N_CORNERS] = {0};
-static uint8_t corner_map[256] = {
-  [ 65] = 0, [ 67] = 1, [ 71] = 2, [ 84] = 3,
-  [ 97] = 0, [ 99] = 1, [103] = 2, [116] = 3,
-  [  0] = 0, [  1] = 1, [  2] = 2, [  3] = 3,
-  [  4] = 0, [  5] = 1, [  6] = 2, [  7] = 3,
-  [  8] = 0, [  9] = 1, [ 10] = 2, [ 11] = 3,
-  [ 12] = 0, [ 13] = 1, [ 14] = 2, [ 15] = 3,
-  [ 16] = 0, [ 17] = 1, [ 18] = 2, [ 19] = 3,
-  [ 20] = 0, [ 21] = 1, [ 22] = 2, [ 23] = 3,
-  [ 24] = 0, [ 25] = 1, [ 26] = 2, [ 27] = 3,
-  [ 28] = 0, [ 29] = 1, [ 30] = 2, [ 31] = 3,
-  [ 32] = 0, [ 33] = 1, [ 34] = 2, [ 35] = 3,
-  [ 36] = 0, [ 37] = 1, [ 38] = 2, [ 39] = 3,
-  [ 40] = 0, [ 41] = 1, [ 42] = 2, [ 43] = 3,
-  [ 44] = 0, [ 45] = 1, [ 46] = 2, [ 47] = 3,
-  [ 48] = 0, [ 49] = 1, [ 50] = 2, [ 51] = 3,
-  [ 52] = 0, [ 53] = 1, [ 54] = 2, [ 55] = 3,
-  [ 56] = 0, [ 57] = 1, [ 58] = 2, [ 59] = 3,
-  [ 60] = 0, [ 61] = 1, [ 62] = 2, [ 63] = 3,
-  [ 64] = 0, [ 66] = 1, [ 68] = 2, [ 69] = 3,
-  [ 70] = 0, [ 72] = 1, [ 73] = 2, [ 74] = 3,
-  [ 75] = 0, [ 76] = 1, [ 77] = 2, [ 78] = 3,
-  [ 79] = 0, [ 80] = 1, [ 81] = 2, [ 82] = 3,
-  [ 83] = 0, [ 85] = 1, [ 86] = 2, [ 87] = 3,
-  [ 88] = 0, [ 89] = 1, [ 90] = 2, [ 91] = 3,
-  [ 92] = 0, [ 93] = 1, [ 94] = 2, [ 95] = 3,
-  [ 96] = 0, [ 98] = 1, [100] = 2, [101] = 3,
-  [102] = 0, [104] = 1, [105] = 2, [106] = 3,
-  [107] = 0, [108] = 1, [109] = 2, [110] = 3,
-  [111] = 0, [112] = 1, [113] = 2, [114] = 3,
-  [115] = 0, [117] = 1, [118] = 2, [119] = 3,
-  [120] = 0, [121] = 1, [122] = 2, [123] = 3,
-  [124] = 0, [125] = 1, [126] = 2, [127] = 3,
-  [128] = 0, [129] = 1, [130] = 2, [131] = 3,
-  [132] = 0, [133] = 1, [134] = 2, [135] = 3,
-  [136] = 0, [137] = 1, [138] = 2, [139] = 3,
-  [140] = 0, [141] = 1, [142] = 2, [143] = 3,
-  [144] = 0, [145] = 1, [146] = 2, [147] = 3,
-  [148] = 0, [149] = 1, [150] = 2, [151] = 3,
-  [152] = 0, [153] = 1, [154] = 2, [155] = 3,
-  [156] = 0, [157] = 1, [158] = 2, [159] = 3,
-  [160] = 0, [161] = 1, [162] = 2, [163] = 3,
-  [164] = 0, [165] = 1, [166] = 2, [167] = 3,
-  [168] = 0, [169] = 1, [170] = 2, [171] = 3,
-  [172] = 0, [173] = 1, [174] = 2, [175] = 3,
-  [176] = 0, [177] = 1, [178] = 2, [179] = 3,
-  [180] = 0, [181] = 1, [182] = 2, [183] = 3,
-  [184] = 0, [185] = 1, [186] = 2, [187] = 3,
-  [188] = 0, [189] = 1, [190] = 2, [191] = 3,
-  [192] = 0, [193] = 1, [194] = 2, [195] = 3,
-  [196] = 0, [197] = 1, [198] = 2, [199] = 3,
-  [200] = 0, [201] = 1, [202] = 2, [203] = 3,
-  [204] = 0, [205] = 1, [206] = 2, [207] = 3,
-  [208] = 0, [209] = 1, [210] = 2, [211] = 3,
-  [212] = 0, [213] = 1, [214] = 2, [215] = 3,
-  [216] = 0, [217] = 1, [218] = 2, [219] = 3,
-  [220] = 0, [221] = 1, [222] = 2, [223] = 3,
-  [224] = 0, [225] = 1, [226] = 2, [227] = 3,
-  [228] = 0, [229] = 1, [230] = 2, [231] = 3,
-  [232] = 0, [233] = 1, [234] = 2, [235] = 3,
-  [236] = 0, [237] = 1, [238] = 2, [239] = 3,
-  [240] = 0, [241] = 1, [242] = 2, [243] = 3,
-  [244] = 0, [245] = 1, [246] = 2, [247] = 3,
-  [248] = 0, [249] = 1, [250] = 2, [251] = 3,
-  [252] = 0, [253] = 1, [254] = 2, [255] = 3,
+static const uint8_t alphabet_corners[ALPHABET_COUNT][256] = {
+  [ALPHABET_PROTEIN] = {
+    [ 65] = 1, [ 67] = 2, [ 68] = 3, [ 69] = 4,
+    [ 70] = 5, [ 71] = 6, [ 72] = 7, [ 73] = 8,
+    [ 75] = 9, [ 76] = 10, [ 77] = 11, [ 78] = 12,
+    [ 80] = 13, [ 81] = 14, [ 82] = 15, [ 83] = 16,
+    [ 84] = 17, [ 86] = 18, [ 87] = 19, [ 89] = 20,
+    [ 97] = 1, [ 99] = 2, [100] = 3, [101] = 4,
+    [102] = 5, [103] = 6, [104] = 7, [105] = 8,
+    [107] = 9, [108] = 10, [109] = 11, [110] = 12,
+    [112] = 13, [113] = 14, [114] = 15, [115] = 16,
+    [116] = 17, [118] = 18, [119] = 19, [121] = 20,
+  },
+  [ALPHABET_DAYHOFF6] = {
+    [ 65] = 1, [ 67] = 2, [ 68] = 3, [ 69] = 3,
+    [ 70] = 4, [ 71] = 1, [ 72] = 5, [ 73] = 6,
+    [ 75] = 5, [ 76] = 6, [ 77] = 6, [ 78] = 3,
+    [ 80] = 1, [ 81] = 3, [ 82] = 5, [ 83] = 1,
+    [ 84] = 1, [ 86] = 6, [ 87] = 4, [ 89] = 4,
+    [ 97] = 1, [ 99] = 2, [100] = 3, [101] = 3,
+    [102] = 4, [103] = 1, [104] = 5, [105] = 6,
+    [107] = 5, [108] = 6, [109] = 6, [110] = 3,
+    [112] = 1, [113] = 3, [114] = 5, [115] = 1,
+    [116] = 1, [118] = 6, [119] = 4, [121] = 4,
+  },
+  [ALPHABET_MURPHY10] = {
+    [ 65] = 3, [ 67] = 2, [ 68] = 8, [ 69] = 8,
+    [ 70] = 7, [ 71] = 4, [ 72] = 10, [ 73] = 1,
+    [ 75] = 9, [ 76] = 1, [ 77] = 1, [ 78] = 8,
+    [ 80] = 6, [ 81] = 8, [ 82] = 9, [ 83] = 5,
+    [ 84] = 5, [ 86] = 1, [ 87] = 7, [ 89] = 7,
+    [ 97] = 3, [ 99] = 2, [100] = 8, [101] = 8,
+    [102] = 7, [103] = 4, [104] = 10, [105] = 1,
+    [107] = 9, [108] = 1, [109] = 1, [110] = 8,
+    [112] = 6, [113] = 8, [114] = 9, [115] = 5,
+    [116] = 5, [118] = 1, [119] = 7, [121] = 7,
+  },
 };
 
+static char* alphabet_labels[ALPHABET_COUNT][CORNERS_MAX] = {
+  [ALPHABET_PROTEIN] = {
+    "A", "C", "D", "E", "F", "G", "H", "I", "K", "L",
+    "M", "N", "P", "Q", "R", "S", "T", "V", "W", "Y",
+  },
+  [ALPHABET_DAYHOFF6] = {"AGPST", "C", "DENQ", "FWY", "HKR", "ILMV"},
+  [ALPHABET_MURPHY10] = {
+    "LVIM", "C", "A", "G", "ST", "P", "FYW", "EDNQ", "KR", "H",
+  },
+};
+
+static uint8_t class_policy[CGR_CLASS_COUNT] = {0};
+static uint8_t corner_map[256] = {0};
+
 static uint8_t* data = NULL;
-static int32_t data_len = 0;
-static int32_t data_idx = 0;
-static bool data_vis = false;
+static int64_t data_len = 0;
+static bool data_mapped = false;
+static int64_t data_idx = 0;
+static _Atomic bool data_vis = false;
+
+// packed sample: 32 bases per word, two bits each, first base in the low
+// bits. Skipped bytes are dropped while packing; restarts and masks (from
+// the policies and from record boundaries) take a slot whose two bits say
+// which one it is, with the slot's position in packed_events and its word
+// flagged in packed_amb, so words without events need no lookups at all.
+// A run of events collapses into one since restarting twice is a no-op
+static uint64_t* packed = NULL;
+static uint64_t* packed_amb = NULL;
+static int64_t packed_len = 0;
+static int64_t packed_cap = 0;
+static int64_t* packed_events = NULL;
+static int64_t packed_n_events = 0;
+static int64_t packed_events_cap = 0;
+static bool parse_pack = false;
+
+// UCSC .2bit sample, mapped and walked in place: each sequence has its
+// bases packed four per byte (T, C, A, G; first base in the high bits) and
+// a sorted table of N blocks. The selected sequences are walked back to
+// back as if they were records of one FASTA file
+typedef struct {
+  char name[256];
+  int64_t start;
+  int64_t len;
+  uint8_t* dna;
+  uint32_t n_blocks;
+  uint8_t* n_starts;
+  uint8_t* n_sizes;
+} cgr_twobit_seq_t;
+
+static uint8_t* twobit_map = NULL;
+static size_t twobit_map_len = 0;
+static cgr_twobit_seq_t* twobit_seqs = NULL;
+static int32_t twobit_n_seqs = 0;
+
+#define PACKED_RESTART 0
+#define PACKED_MASK 1
 
 static Vector2 grid_pos = {0};
 static Vector2 grid_center = {0};
-static int32_t grid_counts[GRID_N][GRID_N] = {0};
+static int32_t grid_n = GRID_N;
+static float grid_cell = 0.0f;
+static int64_t* grid_counts = NULL;
+
+// coarser copies of the grid, level l being about grid_n >> l cells a side
+// and none below PYRAMID_MIN: each cell is the sum of the 2x2 cells under it one
+// level up (a lone last row or column sums on its own). They are rebuilt
+// from the grid when written, never walked into, so the walk pays nothing.
+// In k-mer mode summing 2x2 drops the oldest base, and level l holds the
+// (k - l)-mer counts
+#define PYRAMID_MIN 64
+#define PYRAMID_LEVELS_MAX 16
+
+static int64_t* pyramid[PYRAMID_LEVELS_MAX] = {0};
+static int32_t pyramid_n[PYRAMID_LEVELS_MAX] = {0};
+static int32_t pyramid_levels = 0;
+static int32_t grid_level = 0;
+
+// the window draws the grid as one float texture of counts, stretched over
+// the grid every frame. The shader shades each count by log(1 + count) /
+// log(1 + max) like cgr_grid_color. The texture holds view_level, the first
+// pyramid level no wider than GRID_W, so every cell lands in some texel
+// instead of being skipped by the sampler; view_max is its largest count.
+// While the window is open the walker also flags every span of
+// 2^DIRTY_SHIFT counts it touches in grid_dirty, and only those spans are
+// summed and uploaded: rows of the grid, or square blocks of it in k-mer
+// mode where a span of codes shares its leading bases
+#define DIRTY_SHIFT 12
+
+static bool grid_drawn = false;
+static int32_t view_level = 0;
+static int64_t view_max = 0;
+static Texture2D grid_tex = {0};
+static float* grid_values = NULL;
+static float* grid_block = NULL;
+static uint64_t* grid_dirty = NULL;
+static int64_t grid_spans = 0;
+
+// the walk runs on a producer thread and hands the window snapshots of the
+// counts through three buffers: the producer fills the back one and swaps
+// it with the middle one, the window swaps the middle one for its front one
+// when it holds something new. A span's version is the snapshot it last
+// changed in, so a buffer only needs the spans whose version it lacks and
+// the texture only the spans whose version it has not uploaded
+#define SNAPSHOT_FRESH 4
+#define PRODUCER_STEPS (1 << 18)
+#define PRODUCER_IDLE_US 1000
+
+typedef struct {
+  int64_t* counts;
+  uint32_t* version;
+  int64_t max;
+  int64_t idx;
+} cgr_snapshot_t;
+
+static cgr_snapshot_t snapshots[3] = {0};
+static _Atomic int32_t snapshot_mid = 1;
+static int32_t snapshot_back = 0;
+static int32_t snapshot_front = 2;
+static uint32_t snapshot_seq = 0;
+static uint32_t* span_version = NULL;
+static uint32_t* span_uploaded = NULL;
+
+static pthread_t producer;
+static _Atomic bool producer_quit = false;
+
+static Shader grid_shader = {0};
+static int grid_shader_smax = 0;
+
+static const char* grid_shader_fs =
+  "#version 330\n"
+  "in vec2 fragTexCoord;\n"
+  "in vec4 fragColor;\n"
+  "uniform sampler2D texture0;\n"
+  "uniform vec4 colDiffuse;\n"
+  "uniform float smax;\n"
+  "out vec4 finalColor;\n"
+  "void main() {\n"
+  "  float count = texture(texture0, fragTexCoord).r;\n"
+  "  float a = smax > 0.0 ? log(1.0 + count) / smax : 0.0;\n"
+  "  finalColor = vec4(0.0, 0.0, 0.0, a) * colDiffuse * fragColor;\n"
+  "}\n";
+
+// with --kmer the grid is 2^k cells wide and holds exact k-mer counts: the
+// walk keeps the last k bases as a 2k-bit code, two bits per base (y then
+// x, most recent base on top), and counts into kmer_counts by code. That
+// code is the cell's Z-order index, turned into a row-major grid only when
+// the grid is looked at (cgr_grid_sync), one byte (four bases) at a time
+#define KMER_MAX 12
+
+static int32_t kmer_k = 0;
+static int64_t* kmer_counts = NULL;
+static uint8_t kmer_row_bits[256] = {0};
+static uint8_t kmer_col_bits[256] = {0};
+
+// how blocks of cells are counted. direct adds each one to the grid.
+// split spreads consecutive cells over ACCUM_SPLIT copies of the grid, so
+// runs that hit one cell over and over do not wait on their own stores.
+// radix drops cells into buckets of 2^ACCUM_RADIX_SPAN_BITS neighbouring
+// cells and counts a bucket once it holds ACCUM_RADIX_BUF of them, so a
+// grid larger than the caches is touched one small region at a time.
+// prefetch holds each block back until the next one is known and prefetches
+// the next one's cells first, so the misses of a block overlap. copies,
+// buckets and the held block are folded into the grid by cgr_walker_flush
+#define ACCUM_SPLIT 4
+#define ACCUM_RADIX_SPAN_BITS 14
+#define ACCUM_RADIX_BUF 1024
+#define ACCUM_HELD_MAX 32
+#define ACCUM_DIRECT_MAX (2 << 20)
+
+// one walk over the sample: the sequential one is `walker`, the parallel
+// engine gives each thread its own, counting into its own copy of the grid.
+// `bases` and `restarted` tell when a walk started mid-sample has warmed up
+typedef struct {
+  Vector2 point_pos;
+  uint32_t fixed_x;
+  uint32_t fixed_y;
+  uint32_t kmer_code;
+  int32_t kmer_fill;
+  int32_t hidden;
+  int64_t bases;
+  bool restarted;
+  bool counting;
+  int32_t weight;
+  int64_t* counts;
+  int64_t max;
+  int64_t* split[ACCUM_SPLIT];
+  uint32_t* radix;
+  int32_t* radix_fill;
+  uint32_t held[ACCUM_HELD_MAX];
+  int32_t held_n;
+  int64_t event_idx;
+  int32_t seq_idx;
+} cgr_walker_t;
+
+static cgr_walker_t walker = {0};
+
+// FASTA parsing state, kept across chunks so a header or line can be split
+// over several reads (or several frames)
+typedef struct {
+  cgr_walker_t* w;
+  bool line_start;
+  bool sniffed;
+  bool fastq;
+  int32_t fastq_line;
+  int64_t fastq_seq_len;
+  int64_t fastq_qual_len;
+  bool in_header;
+  bool in_name;
+  char name[256];
+  int32_t name_len;
+  int64_t records;
+  int64_t record_bases;
+} cgr_parser_t;
+
+static cgr_parser_t parser = {0};
+
+// when set, every FASTA record gets its own histogram written here
+static FILE* record_out = NULL;
+
+// FASTQ bases with a phred+33 quality below this are walked as if they
+// were N; the sequence line is held until its quality line arrives
+static int32_t min_qual = 0;
+static uint8_t* fastq_seq = NULL;
+static int64_t fastq_seq_cap = 0;
+
+enum {
+  FASTQ_HEADER = 0,
+  FASTQ_SEQ,
+  FASTQ_PLUS,
+  FASTQ_QUAL,
+};
 
-static Vector2 point_pos = {0};
 static float jump_ratio = 0.5f;
 
+// at jump_ratio 0.5 the position is the bases walked so far read as a
+// binary fraction, most recent base first: x is 1 for the right corners and
+// y for the bottom ones. Kept as 0.32 fixed point, a step is a shift and an
+// or, and the cell is the top bits scaled by grid_n; no rounding, so the
+// walk never drifts and never lands on the far edge
+#define FIXED_CENTER (1u << 31)
+
+static const uint8_t corner_bit_x[DNA_CORNERS] = {0, 0, 1, 1};
+static const uint8_t corner_bit_y[DNA_CORNERS] = {1, 0, 0, 1};
+static bool walk_fixed = false;
+
+// after a masked byte the walk goes on without plotting for this many
+// bases: enough for it to forget the center at grid resolution
+static int32_t mask_steps = 0;
+
+// zoomed in (window, ratio 0.5, not k-mers) the grid covers a square
+// 2^-zoom_depth of the whole wide at (zoom_x, zoom_y), in the same 0.32
+// fixed point as the walk, still with grid_n cells a side; points outside
+// it are not counted. The first zoom indexes the sample: the cell of every
+// point on a 2^ZOOM_INDEX_K grid (its last ZOOM_INDEX_K bases), in walk
+// order, with where each ZOOM_CHUNK byte (or base) chunk of the sample
+// starts in that list. A view then only walks the chunks with a point in
+// a cell under it, each picked up with a warm-up
+#define ZOOM_DEPTH_MAX 16
+#define ZOOM_INDEX_K 12
+#define ZOOM_CHUNK 4096
+
+static bool zoom_on = false;
+static int32_t zoom_depth = 0;
+static uint32_t zoom_x = 0;
+static uint32_t zoom_y = 0;
+static bool zoom_planned = false;
+static bool zoom_cold = false;
+static uint64_t* zoom_todo = NULL;
+
+static bool zoom_indexed = false;
+static bool zoom_indexing = false;
+static int64_t zoom_n_chunks = 0;
+static int64_t* zoom_offsets = NULL;
+static uint32_t* zoom_cells = NULL;
+static int64_t zoom_cells_len = 0;
+static int64_t zoom_cells_cap = 0;
+static uint64_t* zoom_want = NULL;
+
+// skip: the byte is dropped, the walk goes on as if it was not there
+// restart: the walk jumps back to the center
+// mask: restart, and do not plot the points still biased by the center
 static void
-cgr_init(void)
+cgr_init_corner_map(void)
 {
-  grid_pos.x = (WINDOW_W - GRID_W) / 2;
-  grid_pos.y = (WINDOW_H - GRID_H) / 2;
+  for (int32_t i = 0; i < 256; i += 1) {
+    if (alphabet != ALPHABET_DNA) {
+      uint8_t corner = alphabet_corners[alphabet][i];
+      if (corner > 0) {
+        corner_map[i] = corner - 1;
+      } else {
+        corner_map[i] = CORNERS_MAX + class_policy[protein_class[i]];
+      }
+      continue;
+    }
 
-  grid_center.x = grid_pos.x + GRID_W / 2;
-  grid_center.y = grid_pos.y + GRID_H / 2;
+    uint8_t cls = byte_class[i];
+    if (cls >= CGR_CLASS_A && cls <= CGR_CLASS_T) {
+      corner_map[i] = cls - CGR_CLASS_A;
+    } else {
+      corner_map[i] = CORNERS_MAX + class_policy[cls];
+    }
+  }
+}
 
-  point_pos = grid_center;
+static uint8_t
+cgr_parse_policy(char* name)
+{
+  for (int32_t i = 0; i < CGR_POLICY_COUNT; i += 1) {
+    if (strcmp(name, policy_names[i]) == 0) return i;
+  }
 
-  for (int32_t i = 0; i < N_CORNERS; i += 1) {
-    corner_pos[1].x = grid_pos.x;
-    corner_pos[1].y = grid_pos.y;
+  printf("ERROR: unknown policy: %s (skip, restart or mask)\n", name);
+  exit(1);
+}
 
-    corner_pos[0].x = corner_pos[1].x;
-    corner_pos[0].y = corner_pos[1].y + GRID_H;
+static int32_t
+cgr_parse_alphabet(char* name)
+{
+  for (int32_t i = 0; i < ALPHABET_COUNT; i += 1) {
+    if (strcmp(name, alphabet_names[i]) == 0) return i;
+  }
 
-    corner_pos[2].x = corner_pos[1].x + GRID_W;
-    corner_pos[2].y = corner_pos[1].y;
+  printf("ERROR: unknown alphabet: %s (dna, protein, dayhoff6 or murphy10)\n", name);
+  exit(1);
+}
 
-    corner_pos[3].x = corner_pos[1].x + GRID_W;
-    corner_pos[3].y = corner_pos[1].y + GRID_H;
+typedef enum {
+  CGR_ACCUM_AUTO,
+  CGR_ACCUM_DIRECT,
+  CGR_ACCUM_SPLIT,
+  CGR_ACCUM_RADIX,
+  CGR_ACCUM_PREFETCH,
+  CGR_ACCUM_COUNT,
+} cgr_accum_t;
+
+static char* accum_names[CGR_ACCUM_COUNT] = {
+  "auto", "direct", "split", "radix", "prefetch",
+};
+static cgr_accum_t accum = CGR_ACCUM_AUTO;
+
+static cgr_accum_t
+cgr_parse_accum(char* s)
+{
+  for (int32_t i = 0; i < CGR_ACCUM_COUNT; i += 1) {
+    if (strcmp(s, accum_names[i]) == 0) return i;
+  }
+  printf("ERROR: unknown --accum mode: %s\n", s);
+  exit(1);
+}
+
+// cells counted by a walk: the grid, or every k-mer code
+static int64_t
+cgr_count_cells_len(void)
+{
+  if (kmer_k > 0) return (int64_t)1 << (2 * kmer_k);
+  return (int64_t)grid_n * grid_n;
+}
+
+// direct while the counts fit in L2, past that prefetch: measured on 200 MB
+// of text, radix was on par only at k = 12 and split never paid off
+static void
+cgr_init_accum(void)
+{
+  if (accum != CGR_ACCUM_AUTO) return;
+  accum = CGR_ACCUM_DIRECT;
+  if (cgr_count_cells_len() * (int64_t)sizeof(int64_t) > ACCUM_DIRECT_MAX) {
+    accum = CGR_ACCUM_PREFETCH;
+  }
+}
+
+// zeroed counts for `cells` cells, on huge pages when the kernel has them
+// so that scattered increments into a large grid do not also miss the TLB
+static int64_t*
+cgr_counts_alloc(int64_t cells)
+{
+  size_t size = cells * sizeof(int64_t);
+  void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    printf("ERROR: cgr_counts_alloc: %s\n", strerror(errno));
+    exit(1);
+  }
+  madvise(p, size, MADV_HUGEPAGE);
+  return p;
+}
+
+static void
+cgr_counts_free(int64_t* counts, int64_t cells)
+{
+  if (counts != NULL) munmap(counts, cells * sizeof(int64_t));
+}
+
+// every count goes through here so that, while the window is open, the
+// walker knows the largest one, which the grid is scaled by
+static inline void
+cgr_count(cgr_walker_t* w, uint32_t cell, int64_t n)
+{
+  int64_t v = w->counts[cell] += n;
+  if (!grid_drawn) return;
+
+  if (v > w->max) w->max = v;
+  grid_dirty[cell >> DIRTY_SHIFT >> 6] |= 1ull << (cell >> DIRTY_SHIFT & 63);
+}
+
+// the same over a list, with the max held in a register since stores into
+// counts could otherwise be changing it
+static inline void
+cgr_count_list(cgr_walker_t* w, uint32_t* cells, int32_t n)
+{
+  int64_t* counts = w->counts;
+  if (!grid_drawn) {
+    for (int32_t j = 0; j < n; j += 1) counts[cells[j]] += 1;
+    return;
+  }
+
+  int64_t max = w->max;
+  for (int32_t j = 0; j < n; j += 1) {
+    uint32_t cell = cells[j];
+    int64_t v = counts[cell] += 1;
+    if (v > max) max = v;
+    grid_dirty[cell >> DIRTY_SHIFT >> 6] |= 1ull << (cell >> DIRTY_SHIFT & 63);
   }
+  w->max = max;
+}
+
+static void
+cgr_walker_flush(cgr_walker_t* w)
+{
+  int64_t cells = cgr_count_cells_len();
 
-  for (int32_t y = 0; y < GRID_N; y += 1) {
-    for (int32_t x = 0; x < GRID_N; x += 1) {
-      grid_counts[y][x] = 0;
+  for (int32_t s = 0; s < ACCUM_SPLIT; s += 1) {
+    int64_t* copy = w->split[s];
+    if (copy == NULL) continue;
+    for (int64_t c = 0; c < cells; c += 1) {
+      if (copy[c] == 0) continue;
+      cgr_count(w, c, copy[c]);
+      copy[c] = 0;
     }
   }
 
-  data_idx = 0;
-  data_vis = false;
+  if (w->radix != NULL) {
+    int64_t buckets = (cells + (1 << ACCUM_RADIX_SPAN_BITS) - 1) >> ACCUM_RADIX_SPAN_BITS;
+    for (int64_t b = 0; b < buckets; b += 1) {
+      uint32_t* buf = w->radix + b * ACCUM_RADIX_BUF;
+      cgr_count_list(w, buf, w->radix_fill[b]);
+      w->radix_fill[b] = 0;
+    }
+  }
+
+  cgr_count_list(w, w->held, w->held_n);
+  w->held_n = 0;
 }
 
 static void
-cgr_draw_grid(void)
+cgr_walker_free(cgr_walker_t* w)
 {
-  float smax = 0.0f;
-  for (int32_t y = 0; y < GRID_N; y += 1) {
-    for (int32_t x = 0; x < GRID_N; x += 1) {
-      float s = logf(1.0f + grid_counts[y][x]);
-      if (s > smax) smax = s;
+  int64_t cells = cgr_count_cells_len();
+  for (int32_t s = 0; s < ACCUM_SPLIT; s += 1) {
+    cgr_counts_free(w->split[s], cells);
+    w->split[s] = NULL;
+  }
+  free(w->radix);
+  free(w->radix_fill);
+  w->radix = NULL;
+  w->radix_fill = NULL;
+}
+
+static void
+cgr_count_split(cgr_walker_t* w, uint32_t* cells, int32_t n)
+{
+  if (w->split[0] == NULL) {
+    for (int32_t s = 0; s < ACCUM_SPLIT; s += 1) {
+      w->split[s] = cgr_counts_alloc(cgr_count_cells_len());
     }
   }
 
-  for (int32_t y = 0; y < GRID_N; y += 1) {
-    for (int32_t x = 0; x < GRID_N; x += 1) {
-      float s = logf(1.0f + grid_counts[y][x]);
-      Color c = BLACK;
-      c.a = (uint8_t)(s / smax * 255.0f);
+  for (int32_t j = 0; j < n; j += ACCUM_SPLIT) {
+    for (int32_t s = 0; s < ACCUM_SPLIT; s += 1) w->split[s][cells[j + s]] += 1;
+  }
+}
+
+static void
+cgr_count_radix(cgr_walker_t* w, uint32_t* cells, int32_t n)
+{
+  if (w->radix == NULL) {
+    int64_t buckets = (cgr_count_cells_len() + (1 << ACCUM_RADIX_SPAN_BITS) - 1)
+      >> ACCUM_RADIX_SPAN_BITS;
+    w->radix = malloc(sizeof(*w->radix) * buckets * ACCUM_RADIX_BUF);
+    w->radix_fill = calloc(buckets, sizeof(*w->radix_fill));
+    if (w->radix == NULL || w->radix_fill == NULL) {
+      printf("ERROR: cgr_count_radix: out of memory\n");
+      exit(1);
+    }
+  }
 
-      Vector2 rp = {
-        grid_pos.x + x * GRID_PIXELS_PER_CELL,
-        grid_pos.y + y * GRID_PIXELS_PER_CELL,
-      };
-      Vector2 rs = {
-        GRID_PIXELS_PER_CELL,
-        GRID_PIXELS_PER_CELL,
-      };
-      DrawRectangleV(rp, rs, c);
+  for (int32_t j = 0; j < n; j += 1) {
+    uint32_t b = cells[j] >> ACCUM_RADIX_SPAN_BITS;
+    uint32_t* buf = w->radix + (int64_t)b * ACCUM_RADIX_BUF;
+    buf[w->radix_fill[b]] = cells[j];
+    w->radix_fill[b] += 1;
+    if (w->radix_fill[b] == ACCUM_RADIX_BUF) {
+      cgr_count_list(w, buf, ACCUM_RADIX_BUF);
+      w->radix_fill[b] = 0;
     }
   }
 }
 
 static void
-cgr_draw_corners(void)
+cgr_count_prefetch(cgr_walker_t* w, uint32_t* cells, int32_t n)
 {
-  for (int32_t i = 0; i < N_CORNERS; i += 1) {
-    char buf[32] = {0};
-    snprintf(buf, sizeof(buf), "%d", i);
-    Vector2 pos = Vector2Lerp(grid_center, corner_pos[i], 1.07);
-    DrawText(buf, pos.x - 7.5f, pos.y - 15.0f, 20.0f, GRAY);
+  for (int32_t j = 0; j < n; j += 1) __builtin_prefetch(&w->counts[cells[j]], 1);
+  cgr_count_list(w, w->held, w->held_n);
+  memcpy(w->held, cells, sizeof(*cells) * n);
+  w->held_n = n;
+}
+
+// counts a block of at most ACCUM_HELD_MAX cells, n a multiple of
+// ACCUM_SPLIT
+static inline void
+cgr_count_cells(cgr_walker_t* w, uint32_t* cells, int32_t n)
+{
+  if (accum == CGR_ACCUM_SPLIT) {
+    cgr_count_split(w, cells, n);
+  } else if (accum == CGR_ACCUM_RADIX) {
+    cgr_count_radix(w, cells, n);
+  } else if (accum == CGR_ACCUM_PREFETCH) {
+    cgr_count_prefetch(w, cells, n);
+  } else {
+    cgr_count_list(w, cells, n);
   }
 }
 
-// to generate a video out of images:
-// ffmpeg -framerate 10 -pattern_type glob -i 'img-*.png' -c:v libx264 -pix_fmt yuv420p out.mp4
 static void
-cgr_export_screen(void)
+cgr_alloc_grid(void)
 {
-  assert(ExportImage(LoadImageFromScreen(), "image.png"));
+  grid_counts = calloc((size_t)grid_n * grid_n, sizeof(*grid_counts));
+  if (grid_counts == NULL) {
+    printf("ERROR: cgr_alloc_grid: out of memory\n");
+    exit(1);
+  }
+
+  pyramid_n[0] = grid_n;
+  pyramid_levels = 1;
+  while ((pyramid_n[pyramid_levels - 1] + 1) / 2 >= PYRAMID_MIN) {
+    int32_t n = (pyramid_n[pyramid_levels - 1] + 1) / 2;
+    pyramid_n[pyramid_levels] = n;
+    pyramid[pyramid_levels] = malloc(sizeof(int64_t) * n * n);
+    if (pyramid[pyramid_levels] == NULL) {
+      printf("ERROR: cgr_alloc_grid: out of memory\n");
+      exit(1);
+    }
+    pyramid_levels += 1;
+  }
+
+  if (kmer_k > 0) {
+    kmer_counts = cgr_counts_alloc(cgr_count_cells_len());
+
+    for (int32_t b = 0; b < 256; b += 1) {
+      for (int32_t k = 0; k < 4; k += 1) {
+        kmer_row_bits[b] |= (b >> (2 * k + 1) & 1) << k;
+        kmer_col_bits[b] |= (b >> (2 * k) & 1) << k;
+      }
+    }
+  }
 }
 
+// the whole grid goes to the window again
 static void
-cgr_vis_step(void)
+cgr_mark_grid_dirty(void)
 {
-  for (int32_t i = 0; i < VIS_STEPS_PER_ITER; i += 1) {
-    if (!data_vis) return;
-    if (data_idx >= data_len) return;
+  if (grid_dirty == NULL) return;
 
-    Vector2 attr_pos = corner_pos[corner_map[data[data_idx]]];
-    point_pos = Vector2Lerp(point_pos, attr_pos, jump_ratio);
-    data_idx += 1;
+  int64_t words = (grid_spans + 63) / 64;
+  memset(grid_dirty, 0xFF, sizeof(*grid_dirty) * words);
+  if (grid_spans % 64 != 0) grid_dirty[words - 1] = (1ull << grid_spans % 64) - 1;
+}
+
+static void
+cgr_clear_grid(void)
+{
+  memset(grid_counts, 0, sizeof(*grid_counts) * grid_n * grid_n);
+  if (kmer_k > 0) {
+    memset(kmer_counts, 0, sizeof(*kmer_counts) << (2 * kmer_k));
+  }
+  walker.max = 0;
+  cgr_mark_grid_dirty();
+}
 
-    Vector2 p = Vector2Subtract(point_pos, grid_pos);
-    int32_t i = (int32_t)(p.y / GRID_PIXELS_PER_CELL);
-    int32_t j = (int32_t)(p.x / GRID_PIXELS_PER_CELL);
-    grid_counts[i][j] += 1;
+static inline void
+cgr_kmer_cell(uint32_t code, uint32_t* row, uint32_t* col)
+{
+  *row = 0;
+  *col = 0;
+  for (int32_t b = 0; b < kmer_k; b += 4) {
+    uint8_t byte = code >> (2 * b);
+    *row |= (uint32_t)kmer_row_bits[byte] << b;
+    *col |= (uint32_t)kmer_col_bits[byte] << b;
   }
 }
 
+// brings grid_counts up to date before it is written
 static void
-cgr_draw_debug_info(void)
+cgr_grid_sync(void)
 {
-  {
-    char buf[32] = {0};
-    snprintf(
-      buf, sizeof(buf), "vis: %6.2f%%",
-      (float)data_idx / data_len * 100.0f
-    );
-    DrawText(buf, 10.0f, 10.0f, 20.0f, GRAY);
+  if (kmer_k == 0) return;
+
+  uint32_t n_codes = 1u << (2 * kmer_k);
+  for (uint32_t code = 0; code < n_codes; code += 1) {
+    uint32_t row, col;
+    cgr_kmer_cell(code, &row, &col);
+    grid_counts[row * grid_n + col] = kmer_counts[code];
   }
-  {
-    char buf[32] = {0};
-    snprintf(buf, sizeof(buf), "ratio: %4.2f", jump_ratio);
-    DrawText(buf, 10.0f, 30.0f, 20.0f, GRAY);
+}
+
+static inline int64_t
+cgr_level_count(int32_t level, int32_t y, int32_t x)
+{
+  if (level == 0) return grid_counts[y * grid_n + x];
+  return pyramid[level][y * pyramid_n[level] + x];
+}
+
+// sums the synced grid down to grid_level
+static void
+cgr_build_pyramid(void)
+{
+  for (int32_t l = 1; l <= grid_level; l += 1) {
+    int32_t n = pyramid_n[l];
+    int32_t up = pyramid_n[l - 1];
+    for (int32_t y = 0; y < n; y += 1) {
+      for (int32_t x = 0; x < n; x += 1) {
+        int64_t sum = 0;
+        for (int32_t dy = 0; dy < 2 && 2 * y + dy < up; dy += 1) {
+          for (int32_t dx = 0; dx < 2 && 2 * x + dx < up; dx += 1) {
+            sum += cgr_level_count(l - 1, 2 * y + dy, 2 * x + dx);
+          }
+        }
+        pyramid[l][y * n + x] = sum;
+      }
+    }
   }
 }
 
 static void
-cgr_read_sample(char* path)
+cgr_walker_init(cgr_walker_t* w, int64_t* counts)
 {
-  struct stat st = {0};
-  if (stat(path, &st) < 0) {
-    printf("ERROR: cgr_read_sample: %s\n", strerror(errno));
-    exit(1);
+  *w = (cgr_walker_t){0};
+  w->point_pos = grid_center;
+  w->fixed_x = FIXED_CENTER;
+  w->fixed_y = FIXED_CENTER;
+  w->counting = true;
+  w->weight = 1;
+  w->counts = counts;
+}
+
+// the smallest ratio at which the n copies of the polygon the walk
+// shrinks into at each step do not overlap, so the points of each corner
+// stay apart from the others' while filling as much room as they can: at
+// 4 corners it is the square's 0.5
+static float
+cgr_polygon_ratio(int32_t n)
+{
+  double sum = 1.0;
+  for (int32_t k = 1; k <= n / 4; k += 1) sum += cos(2.0 * PI * k / n);
+  return 1.0 - 1.0 / (2.0 * sum);
+}
+
+static void
+cgr_set_ratio(float ratio)
+{
+  jump_ratio = ratio;
+  walk_fixed = jump_ratio == 0.5f && alphabet == ALPHABET_DNA;
+  // a k-mer only counts once its k bases follow the restart, nothing of the
+  // center is left to hide; hiding would also keep blocks off until the
+  // next record
+  mask_steps = 0;
+  if (jump_ratio < 1.0f && kmer_k == 0) {
+    mask_steps = (int32_t)ceilf(logf(grid_n) / -logf(1.0f - jump_ratio));
   }
+}
 
-  if (st.st_size == 0) {
-    printf("ERROR: cgr_read_sample: file is empty\n");
+static void
+cgr_init(void)
+{
+  grid_pos.x = (WINDOW_W - GRID_W) / 2;
+  grid_pos.y = (WINDOW_H - GRID_H) / 2;
+
+  grid_center.x = grid_pos.x + GRID_W / 2;
+  grid_center.y = grid_pos.y + GRID_H / 2;
+
+  n_corners = alphabet_n_corners[alphabet];
+  if (alphabet == ALPHABET_DNA) {
+    corner_pos[1].x = grid_pos.x;
+    corner_pos[1].y = grid_pos.y;
+
+    corner_pos[0].x = corner_pos[1].x;
+    corner_pos[0].y = corner_pos[1].y + GRID_H;
+
+    corner_pos[2].x = corner_pos[1].x + GRID_W;
+    corner_pos[2].y = corner_pos[1].y;
+
+    corner_pos[3].x = corner_pos[1].x + GRID_W;
+    corner_pos[3].y = corner_pos[1].y + GRID_H;
+  } else {
+    // on the circle the grid is drawn around, the first corner at the top
+    // and the rest counter-clockwise
+    for (int32_t i = 0; i < n_corners; i += 1) {
+      double angle = PI / 2.0 + 2.0 * PI * i / n_corners;
+      corner_pos[i].x = grid_center.x + GRID_W / 2.0 * cos(angle);
+      corner_pos[i].y = grid_center.y - GRID_H / 2.0 * sin(angle);
+    }
+  }
+
+  grid_cell = (float)GRID_W / grid_n;
+  cgr_clear_grid();
+
+  cgr_set_ratio(jump_ratio);
+
+  cgr_walker_free(&walker);
+  cgr_walker_init(&walker, kmer_k > 0 ? kmer_counts : grid_counts);
+  parser = (cgr_parser_t){.w = &walker, .line_start = true};
+
+  data_idx = 0;
+  data_vis = false;
+  zoom_on = false;
+  zoom_depth = 0;
+}
+
+static float
+cgr_grid_smax(void)
+{
+  int32_t n = pyramid_n[grid_level];
+  float smax = 0.0f;
+  for (int32_t y = 0; y < n; y += 1) {
+    for (int32_t x = 0; x < n; x += 1) {
+      float s = logf(1.0f + cgr_level_count(grid_level, y, x));
+      if (s > smax) smax = s;
+    }
+  }
+
+  return smax;
+}
+
+static Color
+cgr_grid_color(int64_t count, float smax)
+{
+  Color c = BLACK;
+  c.a = 0;
+  // nothing was counted, every cell is empty
+  if (smax == 0.0f) return c;
+
+  float s = logf(1.0f + count);
+  c.a = (uint8_t)(s / smax * 255.0f);
+
+  return c;
+}
+
+// needs the window, the texture and the shader live on the GPU
+static void
+cgr_load_grid_texture(void)
+{
+  view_level = 0;
+  while (view_level < pyramid_levels - 1 && pyramid_n[view_level] > GRID_W) {
+    view_level += 1;
+  }
+  view_max = 0;
+  int32_t n = pyramid_n[view_level];
+
+  grid_values = calloc((size_t)n * n, sizeof(*grid_values));
+  if (grid_values == NULL) {
+    printf("ERROR: cgr_load_grid_texture: out of memory\n");
     exit(1);
   }
 
-  if (st.st_size > INT32_MAX) {
-    printf("ERROR: cgr_read_sample: file too big (%ld bytes)", st.st_size);
+  Image img = {
+    .data = grid_values,
+    .width = n,
+    .height = n,
+    .mipmaps = 1,
+    .format = PIXELFORMAT_UNCOMPRESSED_R32,
+  };
+  grid_tex = LoadTextureFromImage(img);
+  if (!IsTextureValid(grid_tex)) {
+    printf("ERROR: cgr_load_grid_texture: no float textures\n");
     exit(1);
   }
+  SetTextureFilter(grid_tex, TEXTURE_FILTER_POINT);
 
-  int fd = open(path, O_RDONLY);
-  if (fd < 0) {
-    printf("ERROR: cgr_read_sample: %s\n", strerror(errno));
+  grid_shader = LoadShaderFromMemory(NULL, grid_shader_fs);
+  if (grid_shader.id == rlGetShaderIdDefault()) {
+    printf("ERROR: cgr_load_grid_texture: grid shader did not compile\n");
     exit(1);
   }
+  grid_shader_smax = GetShaderLocation(grid_shader, "smax");
 
-  data_len = (int32_t)st.st_size;
-  data = malloc(sizeof(*data) * data_len);
-  ssize_t read_len = read(fd, data, data_len);
-  if (read_len < 0) {
-    printf("ERROR: cgr_read_sample: %s\n", strerror(errno));
+  grid_block = malloc(sizeof(*grid_block) << DIRTY_SHIFT);
+  if (grid_block == NULL) {
+    printf("ERROR: cgr_load_grid_texture: out of memory\n");
     exit(1);
   }
-  assert(read_len != 0);
+}
 
-  close(fd);
+static void
+cgr_unload_grid_texture(void)
+{
+  UnloadShader(grid_shader);
+  UnloadTexture(grid_tex);
+  free(grid_values);
+  free(grid_block);
+  grid_shader = (Shader){0};
+  grid_tex = (Texture2D){0};
+  grid_values = NULL;
+  grid_block = NULL;
 }
 
-int
-main(int argc, char** argv)
+// runs before the walk starts feeding the window
+static void
+cgr_alloc_snapshots(void)
 {
-  if (argc != 2) {
-    printf("ERROR: <file> not provided\n");
-    printf("USAGE: %s <file>\n", argv[0]);
+  int64_t cells = cgr_count_cells_len();
+  grid_spans = (cells + (1 << DIRTY_SHIFT) - 1) >> DIRTY_SHIFT;
+  grid_dirty = calloc((grid_spans + 63) / 64, sizeof(*grid_dirty));
+  span_version = calloc(grid_spans, sizeof(*span_version));
+  span_uploaded = calloc(grid_spans, sizeof(*span_uploaded));
+  if (grid_dirty == NULL || span_version == NULL || span_uploaded == NULL) {
+    printf("ERROR: cgr_alloc_snapshots: out of memory\n");
     exit(1);
   }
 
-  cgr_read_sample(argv[1]);
-  cgr_init();
+  for (int32_t i = 0; i < 3; i += 1) {
+    snapshots[i].counts = cgr_counts_alloc(cells);
+    snapshots[i].version = calloc(grid_spans, sizeof(*snapshots[i].version));
+    if (snapshots[i].version == NULL) {
+      printf("ERROR: cgr_alloc_snapshots: out of memory\n");
+      exit(1);
+    }
+  }
+  grid_drawn = true;
+}
+
+static void
+cgr_free_snapshots(void)
+{
+  int64_t cells = cgr_count_cells_len();
+  for (int32_t i = 0; i < 3; i += 1) {
+    cgr_counts_free(snapshots[i].counts, cells);
+    free(snapshots[i].version);
+    snapshots[i] = (cgr_snapshot_t){0};
+  }
+  free(grid_dirty);
+  free(span_version);
+  free(span_uploaded);
+  grid_dirty = NULL;
+  span_version = NULL;
+  span_uploaded = NULL;
+  grid_drawn = false;
+}
+
+// copies the spans the walk touched since the back buffer was last filled
+// and hands it over, unless the window has not taken the previous one yet
+static bool
+cgr_publish(void)
+{
+  if (atomic_load(&snapshot_mid) & SNAPSHOT_FRESH) return false;
+
+  snapshot_seq += 1;
+  int64_t words = (grid_spans + 63) / 64;
+  for (int64_t i = 0; i < words; i += 1) {
+    uint64_t bits = grid_dirty[i];
+    grid_dirty[i] = 0;
+    while (bits != 0) {
+      span_version[i * 64 + __builtin_ctzll(bits)] = snapshot_seq;
+      bits &= bits - 1;
+    }
+  }
+
+  cgr_snapshot_t* back = &snapshots[snapshot_back];
+  int64_t cells = cgr_count_cells_len();
+  for (int64_t i = 0; i < grid_spans; i += 1) {
+    if (back->version[i] == span_version[i]) continue;
+    int64_t from = i << DIRTY_SHIFT;
+    int64_t n = cells - from;
+    if (n > 1 << DIRTY_SHIFT) n = 1 << DIRTY_SHIFT;
+    memcpy(back->counts + from, walker.counts + from, sizeof(int64_t) * n);
+    back->version[i] = span_version[i];
+  }
+  back->max = walker.max;
+  back->idx = data_idx;
+
+  snapshot_back = atomic_exchange(&snapshot_mid, snapshot_back | SNAPSHOT_FRESH) & 3;
+  return true;
+}
+
+// sum of the grid cells under view cell (y, x), clipped like the pyramid
+static int64_t
+cgr_view_count(int64_t* counts, int32_t y, int32_t x)
+{
+  int32_t y1 = (y + 1) << view_level;
+  int32_t x1 = (x + 1) << view_level;
+  if (y1 > grid_n) y1 = grid_n;
+  if (x1 > grid_n) x1 = grid_n;
+
+  int64_t sum = 0;
+  for (int32_t gy = y << view_level; gy < y1; gy += 1) {
+    for (int32_t gx = x << view_level; gx < x1; gx += 1) {
+      sum += counts[(int64_t)gy * grid_n + gx];
+    }
+  }
+  return sum;
+}
+
+// sum of the 4^view_level codes from `code` on, which share a view cell
+static int64_t
+cgr_view_kmer_count(int64_t* counts, uint32_t code)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < 1u << (2 * view_level); i += 1) {
+    sum += counts[code + i];
+  }
+  return sum;
+}
+
+static void
+cgr_upload_grid(int64_t* counts)
+{
+  int32_t n = pyramid_n[view_level];
+  view_max = 0;
+  if (kmer_k > 0) {
+    uint32_t codes = 1u << (2 * kmer_k);
+    for (uint32_t code = 0; code < codes; code += 1u << (2 * view_level)) {
+      uint32_t row, col;
+      cgr_kmer_cell(code, &row, &col);
+      int64_t count = cgr_view_kmer_count(counts, code);
+      grid_values[(row >> view_level) * n + (col >> view_level)] = count;
+      if (count > view_max) view_max = count;
+    }
+  } else {
+    for (int32_t y = 0; y < n; y += 1) {
+      for (int32_t x = 0; x < n; x += 1) {
+        int64_t count = cgr_view_count(counts, y, x);
+        grid_values[y * n + x] = count;
+        if (count > view_max) view_max = count;
+      }
+    }
+  }
+  UpdateTexture(grid_tex, grid_values);
+}
+
+// counts only grow between full uploads, so view_max can only grow here
+static void
+cgr_upload_span(int64_t* counts, int64_t span)
+{
+  int64_t cells = (int64_t)grid_n * grid_n;
+  int64_t from = span << DIRTY_SHIFT;
+  int64_t to = from + (1 << DIRTY_SHIFT);
+  if (to > cells) to = cells;
+
+  if (kmer_k > 0) {
+    // whole view cells, which at coarse levels hold more than the span
+    uint32_t block = 1u << (2 * view_level);
+    int32_t side = (1 << (DIRTY_SHIFT / 2)) >> view_level;
+    if (side > grid_n >> view_level) side = grid_n >> view_level;
+    if (side < 1) side = 1;
+    from &= ~(int64_t)(block - 1);
+    uint32_t row0, col0;
+    cgr_kmer_cell(from, &row0, &col0);
+    row0 >>= view_level;
+    col0 >>= view_level;
+    for (int64_t code = from; code < to; code += block) {
+      uint32_t row, col;
+      cgr_kmer_cell(code, &row, &col);
+      int64_t count = cgr_view_kmer_count(counts, code);
+      grid_block[((row >> view_level) - row0) * side + (col >> view_level) - col0] = count;
+      if (count > view_max) view_max = count;
+    }
+    Rectangle rec = {col0, row0, side, side};
+    UpdateTextureRec(grid_tex, rec, grid_block);
+    return;
+  }
+
+  int32_t n = pyramid_n[view_level];
+  int32_t row0 = (from / grid_n) >> view_level;
+  int32_t row1 = (((to - 1) / grid_n) >> view_level) + 1;
+  for (int32_t y = row0; y < row1; y += 1) {
+    for (int32_t x = 0; x < n; x += 1) {
+      int64_t count = cgr_view_count(counts, y, x);
+      grid_values[y * n + x] = count;
+      if (count > view_max) view_max = count;
+    }
+  }
+  Rectangle rec = {0, row0, n, row1 - row0};
+  UpdateTextureRec(grid_tex, rec, grid_values + (int64_t)row0 * n);
+}
+
+// takes the newest snapshot, if there is one the window has not seen yet
+static cgr_snapshot_t*
+cgr_take_snapshot(void)
+{
+  if (atomic_load(&snapshot_mid) & SNAPSHOT_FRESH) {
+    snapshot_front = atomic_exchange(&snapshot_mid, snapshot_front) & 3;
+  }
+  return &snapshots[snapshot_front];
+}
+
+// uploads the spans that changed since the last upload, or the whole grid
+// once more than half of them did
+static void
+cgr_sync_grid_texture(cgr_snapshot_t* snap)
+{
+  int64_t stale = 0;
+  for (int64_t i = 0; i < grid_spans; i += 1) {
+    stale += snap->version[i] != span_uploaded[i];
+  }
+  if (stale == 0) return;
+
+  if (stale * 2 > grid_spans) {
+    cgr_upload_grid(snap->counts);
+    memcpy(span_uploaded, snap->version, sizeof(*span_uploaded) * grid_spans);
+    return;
+  }
+
+  for (int64_t i = 0; i < grid_spans; i += 1) {
+    if (snap->version[i] == span_uploaded[i]) continue;
+    cgr_upload_span(snap->counts, i);
+    span_uploaded[i] = snap->version[i];
+  }
+}
+
+static void
+cgr_draw_grid(cgr_snapshot_t* snap)
+{
+  cgr_sync_grid_texture(snap);
+
+  float smax = logf(1.0f + view_max);
+  SetShaderValue(grid_shader, grid_shader_smax, &smax, SHADER_UNIFORM_FLOAT);
+
+  int32_t n = pyramid_n[view_level];
+  Rectangle src = {0.0f, 0.0f, n, n};
+  Rectangle dst = {grid_pos.x, grid_pos.y, GRID_W, GRID_H};
+  BeginShaderMode(grid_shader);
+  DrawTexturePro(grid_tex, src, dst, Vector2Zero(), 0.0f, WHITE);
+  EndShaderMode();
+}
+
+static void
+cgr_draw_corners(void)
+{
+  for (int32_t i = 0; i < n_corners; i += 1) {
+    Vector2 pos = Vector2Lerp(grid_center, corner_pos[i], 1.07);
+    if (alphabet == ALPHABET_DNA) {
+      char buf[32] = {0};
+      snprintf(buf, sizeof(buf), "%d", i);
+      DrawText(buf, pos.x - 7.5f, pos.y - 15.0f, 20.0f, GRAY);
+      continue;
+    }
+
+    // protein corners are named by their residues
+    char* label = alphabet_labels[alphabet][i];
+    int32_t label_w = MeasureText(label, 20);
+    DrawText(label, pos.x - label_w / 2.0f, pos.y - 10.0f, 20, GRAY);
+  }
+}
+
+// to generate a video out of images:
+// ffmpeg -framerate 10 -pattern_type glob -i 'img-*.png' -c:v libx264 -pix_fmt yuv420p out.mp4
+static void
+cgr_export_screen(void)
+{
+  assert(ExportImage(LoadImageFromScreen(), "image.png"));
+}
+
+// same shading as cgr_draw_grid, blended onto the background on the CPU so
+// it works without a window (and without a GL context); cells are a whole
+// number of pixels, as many as fit in GRID_W
+static void
+cgr_export_grid_image(char* path)
+{
+  cgr_grid_sync();
+  cgr_build_pyramid();
+  float smax = cgr_grid_smax();
+  int32_t n = pyramid_n[grid_level];
+  int32_t px = GRID_W / n > 0 ? GRID_W / n : 1;
+  int32_t w = n * px;
+  Image img = GenImageColor(w, w, RAYWHITE);
+  Color* pixels = img.data;
+
+  for (int32_t y = 0; y < n; y += 1) {
+    for (int32_t x = 0; x < n; x += 1) {
+      Color c = cgr_grid_color(cgr_level_count(grid_level, y, x), smax);
+      c = ColorAlphaBlend(RAYWHITE, c, WHITE);
+      for (int32_t dy = 0; dy < px; dy += 1) {
+        for (int32_t dx = 0; dx < px; dx += 1) {
+          pixels[(y * px + dy) * w + x * px + dx] = c;
+        }
+      }
+    }
+  }
+
+  if (!ExportImage(img, path)) {
+    printf("ERROR: cgr_export_grid_image: could not write %s\n", path);
+    exit(1);
+  }
+  UnloadImage(img);
+}
+
+// histogram format: a `>name` line followed by n lines of n space
+// separated counts (n being the side of grid_level), row 0 being the top
+// of the image; several of them can be concatenated in one file
+static void
+cgr_write_grid_counts(FILE* f, char* name)
+{
+  cgr_grid_sync();
+  cgr_build_pyramid();
+  int32_t n = pyramid_n[grid_level];
+  fprintf(f, ">%s\n", name);
+  for (int32_t y = 0; y < n; y += 1) {
+    for (int32_t x = 0; x < n; x += 1) {
+      int64_t count = cgr_level_count(grid_level, y, x);
+      fprintf(f, x == 0 ? "%" PRId64 : " %" PRId64, count);
+    }
+    fputc('\n', f);
+  }
+
+  if (ferror(f)) {
+    printf("ERROR: cgr_write_grid_counts: %s\n", strerror(errno));
+    exit(1);
+  }
+}
+
+static FILE*
+cgr_open_output(char* path)
+{
+  FILE* f = fopen(path, "w");
+  if (f == NULL) {
+    printf("ERROR: cgr_open_output: %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+
+  return f;
+}
+
+static void
+cgr_close_output(FILE* f)
+{
+  if (fclose(f) != 0) {
+    printf("ERROR: cgr_close_output: %s\n", strerror(errno));
+    exit(1);
+  }
+}
+
+static void
+cgr_export_grid_counts(char* path, char* name)
+{
+  FILE* f = cgr_open_output(path);
+  cgr_write_grid_counts(f, name);
+  cgr_close_output(f);
+}
+
+static inline void
+cgr_walk_restart(cgr_walker_t* w, bool mask)
+{
+  w->point_pos = grid_center;
+  w->fixed_x = FIXED_CENTER;
+  w->fixed_y = FIXED_CENTER;
+  w->kmer_fill = 0;
+  w->hidden = mask ? mask_steps : 0;
+  w->bases = 0;
+  w->restarted = true;
+}
+
+static void
+cgr_zoom_grow(void)
+{
+  zoom_cells_cap = zoom_cells_cap == 0 ? 1 << 20 : zoom_cells_cap * 2;
+  zoom_cells = realloc(zoom_cells, sizeof(*zoom_cells) * zoom_cells_cap);
+  if (zoom_cells == NULL) {
+    printf("ERROR: cgr_zoom_grow: out of memory\n");
+    exit(1);
+  }
+}
+
+static inline void
+cgr_count_zoom(cgr_walker_t* w)
+{
+  if (zoom_indexing) {
+    int32_t shift = 32 - ZOOM_INDEX_K;
+    if (zoom_cells_len == zoom_cells_cap) cgr_zoom_grow();
+    zoom_cells[zoom_cells_len] = w->fixed_y >> shift << ZOOM_INDEX_K | w->fixed_x >> shift;
+    zoom_cells_len += 1;
+    return;
+  }
+
+  // below the square the differences wrap around to beyond its side
+  int32_t shift = 32 - zoom_depth;
+  uint64_t dx = (uint64_t)w->fixed_x - zoom_x;
+  uint64_t dy = (uint64_t)w->fixed_y - zoom_y;
+  if (dx >> shift != 0 || dy >> shift != 0) return;
+
+  uint32_t i = dy * grid_n >> shift;
+  uint32_t j = dx * grid_n >> shift;
+  cgr_count(w, i * grid_n + j, 1);
+}
+
+static inline void
+cgr_walk_corner(cgr_walker_t* w, uint8_t corner)
+{
+  w->bases += 1;
+
+  if (kmer_k > 0) {
+    uint32_t z = corner_bit_y[corner] << 1 | corner_bit_x[corner];
+    w->kmer_code = w->kmer_code >> 2 | z << (2 * kmer_k - 2);
+    if (w->kmer_fill < kmer_k - 1) {
+      w->kmer_fill += 1;
+      return;
+    }
+    if (!w->counting) return;
+
+    cgr_count(w, w->kmer_code, 1);
+    return;
+  }
+
+  if (walk_fixed) {
+    w->fixed_x = w->fixed_x >> 1 | (uint32_t)corner_bit_x[corner] << 31;
+    w->fixed_y = w->fixed_y >> 1 | (uint32_t)corner_bit_y[corner] << 31;
+    if (w->hidden > 0) {
+      w->hidden -= 1;
+      return;
+    }
+    if (!w->counting) return;
+    if (zoom_on) {
+      cgr_count_zoom(w);
+      return;
+    }
+
+    uint32_t i = (uint64_t)w->fixed_y * grid_n >> 32;
+    uint32_t j = (uint64_t)w->fixed_x * grid_n >> 32;
+    cgr_count(w, i * grid_n + j, 1);
+    return;
+  }
+
+  w->point_pos = Vector2Lerp(w->point_pos, corner_pos[corner], jump_ratio);
+  if (w->hidden > 0) {
+    w->hidden -= 1;
+    return;
+  }
+  if (!w->counting) return;
+
+  // float rounding lets long runs of one base land exactly on the far
+  // edge of the grid, which belongs to the last cell
+  Vector2 p = Vector2Subtract(w->point_pos, grid_pos);
+  int32_t i = (int32_t)(p.y / grid_cell);
+  int32_t j = (int32_t)(p.x / grid_cell);
+  if (i > grid_n - 1) i = grid_n - 1;
+  if (j > grid_n - 1) j = grid_n - 1;
+  cgr_count(w, i * grid_n + j, w->weight);
+}
+
+// at ratio 0.5 and in k-mer mode the state after a base is just the bases
+// before it, so a block of plain bases can be walked at once: the x and y
+// bits of 32 bases are gathered into masks, one bit per base, and the
+// register after base j of the block is a window of the 64-bit word
+// (mask << 32 | register), shifted right by j + 1. Every base of the block
+// gets its cell from its own shift, with no dependency between them.
+//
+// the kernels below translate text to masks with byte shuffles on the low
+// nibble of each byte (A, C, G, T and U all differ there) and compute the
+// cells of a block in 64-bit lanes; the widest set the cpu has is picked at
+// startup, --simd forces one
+#define SIMD_BLOCK 32
+
+typedef enum {
+  CGR_SIMD_SCALAR,
+  CGR_SIMD_SSE4,
+  CGR_SIMD_AVX2,
+  CGR_SIMD_AVX512,
+  CGR_SIMD_COUNT,
+} cgr_simd_level_t;
+
+static char* simd_names[CGR_SIMD_COUNT] = {"scalar", "sse4", "avx2", "avx512"};
+
+// per low nibble: the upper case letter that is a base there (0x20, which
+// no byte and 0xDF gives, where there is none) and its x and y bits at 0x80
+static uint8_t simd_letter[16] = {0};
+static uint8_t simd_x[16] = {0};
+static uint8_t simd_y[16] = {0};
+
+// x and y bits of the 4 bases in a byte of packed bases
+static uint8_t packed_bits_x[256] = {0};
+static uint8_t packed_bits_y[256] = {0};
+
+static struct {
+  cgr_simd_level_t level;
+  bool (*translate)(uint8_t* buf, uint32_t* mx, uint32_t* my);
+  void (*fixed_cells)(uint64_t ux, uint64_t uy, uint32_t* cells);
+} simd = {0};
+
+static bool
+cgr_translate_scalar(uint8_t* buf, uint32_t* mx, uint32_t* my)
+{
+  uint32_t x = 0;
+  uint32_t y = 0;
+  for (int32_t j = 0; j < SIMD_BLOCK; j += 1) {
+    uint8_t n = buf[j] & 15;
+    if ((buf[j] & 0xDF) != simd_letter[n]) return false;
+    x |= (uint32_t)(simd_x[n] >> 7) << j;
+    y |= (uint32_t)(simd_y[n] >> 7) << j;
+  }
+  *mx = x;
+  *my = y;
+  return true;
+}
+
+__attribute__((target("sse4.1"))) static bool
+cgr_translate_sse4(uint8_t* buf, uint32_t* mx, uint32_t* my)
+{
+  __m128i letter = _mm_loadu_si128((__m128i*)simd_letter);
+  __m128i tx = _mm_loadu_si128((__m128i*)simd_x);
+  __m128i ty = _mm_loadu_si128((__m128i*)simd_y);
+  __m128i low = _mm_set1_epi8(15);
+  __m128i upper = _mm_set1_epi8((char)0xDF);
+
+  uint32_t x = 0;
+  uint32_t y = 0;
+  for (int32_t j = 0; j < SIMD_BLOCK; j += 16) {
+    __m128i b = _mm_loadu_si128((__m128i*)(buf + j));
+    __m128i n = _mm_and_si128(b, low);
+    __m128i ok = _mm_cmpeq_epi8(
+      _mm_and_si128(b, upper), _mm_shuffle_epi8(letter, n)
+    );
+    if (_mm_movemask_epi8(ok) != 0xFFFF) return false;
+    x |= (uint32_t)_mm_movemask_epi8(_mm_shuffle_epi8(tx, n)) << j;
+    y |= (uint32_t)_mm_movemask_epi8(_mm_shuffle_epi8(ty, n)) << j;
+  }
+  *mx = x;
+  *my = y;
+  return true;
+}
+
+__attribute__((target("avx2"))) static bool
+cgr_translate_avx2(uint8_t* buf, uint32_t* mx, uint32_t* my)
+{
+  __m256i letter = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((__m128i*)simd_letter)
+  );
+  __m256i tx = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)simd_x));
+  __m256i ty = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)simd_y));
+
+  __m256i b = _mm256_loadu_si256((__m256i*)buf);
+  __m256i n = _mm256_and_si256(b, _mm256_set1_epi8(15));
+  __m256i ok = _mm256_cmpeq_epi8(
+    _mm256_and_si256(b, _mm256_set1_epi8((char)0xDF)),
+    _mm256_shuffle_epi8(letter, n)
+  );
+  if ((uint32_t)_mm256_movemask_epi8(ok) != 0xFFFFFFFF) return false;
+  *mx = _mm256_movemask_epi8(_mm256_shuffle_epi8(tx, n));
+  *my = _mm256_movemask_epi8(_mm256_shuffle_epi8(ty, n));
+  return true;
+}
+
+static void
+cgr_fixed_cells_scalar(uint64_t ux, uint64_t uy, uint32_t* cells)
+{
+  for (int32_t j = 0; j < SIMD_BLOCK; j += 1) {
+    uint32_t i = (uint64_t)(uint32_t)(uy >> (j + 1)) * grid_n >> 32;
+    uint32_t k = (uint64_t)(uint32_t)(ux >> (j + 1)) * grid_n >> 32;
+    cells[j] = i * grid_n + k;
+  }
+}
+
+__attribute__((target("avx2"))) static void
+cgr_fixed_cells_avx2(uint64_t ux, uint64_t uy, uint32_t* cells)
+{
+  __m256i vx = _mm256_set1_epi64x(ux);
+  __m256i vy = _mm256_set1_epi64x(uy);
+  __m256i vn = _mm256_set1_epi64x(grid_n);
+  __m256i shift = _mm256_setr_epi64x(1, 2, 3, 4);
+  __m256i lanes = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+  for (int32_t j = 0; j < SIMD_BLOCK; j += 4) {
+    // mul_epu32 only reads the low half of each lane, the window
+    __m256i x = _mm256_srlv_epi64(vx, shift);
+    __m256i y = _mm256_srlv_epi64(vy, shift);
+    __m256i k = _mm256_srli_epi64(_mm256_mul_epu32(x, vn), 32);
+    __m256i i = _mm256_srli_epi64(_mm256_mul_epu32(y, vn), 32);
+    __m256i c = _mm256_add_epi64(_mm256_mul_epu32(i, vn), k);
+    c = _mm256_permutevar8x32_epi32(c, lanes);
+    _mm_storeu_si128((__m128i*)(cells + j), _mm256_castsi256_si128(c));
+    shift = _mm256_add_epi64(shift, _mm256_set1_epi64x(4));
+  }
+}
+
+__attribute__((target("avx512f"))) static void
+cgr_fixed_cells_avx512(uint64_t ux, uint64_t uy, uint32_t* cells)
+{
+  __m512i vx = _mm512_set1_epi64(ux);
+  __m512i vy = _mm512_set1_epi64(uy);
+  __m512i vn = _mm512_set1_epi64(grid_n);
+  __m512i shift = _mm512_setr_epi64(1, 2, 3, 4, 5, 6, 7, 8);
+
+  for (int32_t j = 0; j < SIMD_BLOCK; j += 8) {
+    __m512i x = _mm512_srlv_epi64(vx, shift);
+    __m512i y = _mm512_srlv_epi64(vy, shift);
+    __m512i k = _mm512_srli_epi64(_mm512_mul_epu32(x, vn), 32);
+    __m512i i = _mm512_srli_epi64(_mm512_mul_epu32(y, vn), 32);
+    __m512i c = _mm512_add_epi64(_mm512_mul_epu32(i, vn), k);
+    _mm256_storeu_si256((__m256i*)(cells + j), _mm512_cvtepi64_epi32(c));
+    shift = _mm512_add_epi64(shift, _mm512_set1_epi64(8));
+  }
+}
+
+static cgr_simd_level_t
+cgr_simd_detect(void)
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return CGR_SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2")) return CGR_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse4.1")) return CGR_SIMD_SSE4;
+  return CGR_SIMD_SCALAR;
+}
+
+static cgr_simd_level_t
+cgr_parse_simd(char* s)
+{
+  for (int32_t i = 0; i < CGR_SIMD_COUNT; i += 1) {
+    if (strcmp(s, simd_names[i]) == 0) return i;
+  }
+  printf("ERROR: unknown --simd level: %s\n", s);
+  exit(1);
+}
+
+// runs after cgr_init_corner_map, the translation follows the policies
+static void
+cgr_init_simd(cgr_simd_level_t level)
+{
+  if (level > cgr_simd_detect()) {
+    printf("ERROR: this cpu does not support --simd %s\n", simd_names[level]);
+    exit(1);
+  }
+  simd.level = level;
+  simd.translate = cgr_translate_scalar;
+  simd.fixed_cells = cgr_fixed_cells_scalar;
+  if (level >= CGR_SIMD_SSE4) simd.translate = cgr_translate_sse4;
+  if (level >= CGR_SIMD_AVX2) {
+    simd.translate = cgr_translate_avx2;
+    simd.fixed_cells = cgr_fixed_cells_avx2;
+  }
+  if (level >= CGR_SIMD_AVX512) simd.fixed_cells = cgr_fixed_cells_avx512;
+
+  memset(simd_letter, 0x20, sizeof(simd_letter));
+  memset(simd_x, 0, sizeof(simd_x));
+  memset(simd_y, 0, sizeof(simd_y));
+  for (int32_t c = 'Z'; c >= 'A'; c -= 1) {
+    uint8_t corner = corner_map[c];
+    if (corner >= DNA_CORNERS || corner_map[c | 0x20] != corner) continue;
+    simd_letter[c & 15] = c;
+    simd_x[c & 15] = corner_bit_x[corner] << 7;
+    simd_y[c & 15] = corner_bit_y[corner] << 7;
+  }
+
+  for (int32_t v = 0; v < 256; v += 1) {
+    packed_bits_x[v] = 0;
+    packed_bits_y[v] = 0;
+    for (int32_t c = 0; c < 4; c += 1) {
+      uint8_t corner = v >> (c * 2) & 3;
+      packed_bits_x[v] |= corner_bit_x[corner] << c;
+      packed_bits_y[v] |= corner_bit_y[corner] << c;
+    }
+  }
+}
+
+// spreads the 16 low bits of v to the even bits
+static inline uint32_t
+cgr_spread16(uint32_t v)
+{
+  v &= 0xFFFF;
+  v = (v | v << 8) & 0x00FF00FF;
+  v = (v | v << 4) & 0x0F0F0F0F;
+  v = (v | v << 2) & 0x33333333;
+  v = (v | v << 1) & 0x55555555;
+  return v;
+}
+
+// whether the next block of plain bases can skip cgr_walk_corner: counting,
+// nothing hidden and, for k-mers, a full k-mer in the register
+static inline bool
+cgr_walk_block_ready(cgr_walker_t* w)
+{
+  if (!w->counting || w->hidden > 0) return false;
+  if (kmer_k > 0) return w->kmer_fill == kmer_k - 1;
+  return walk_fixed && !zoom_on;
+}
+
+// walks SIMD_BLOCK plain bases given as their x and y masks
+static void
+cgr_walk_block(cgr_walker_t* w, uint32_t mx, uint32_t my)
+{
+  w->bases += SIMD_BLOCK;
+
+  if (kmer_k > 0) {
+    int32_t low = 32 - 2 * kmer_k;
+    uint32_t mask = (1u << (2 * kmer_k)) - 1;
+    uint32_t codes[SIMD_BLOCK];
+    for (int32_t h = 0; h < SIMD_BLOCK; h += 16) {
+      uint32_t z = cgr_spread16(mx >> h) | cgr_spread16(my >> h) << 1;
+      uint64_t u = (uint64_t)z << 32 | (uint64_t)w->kmer_code << low;
+      for (int32_t j = 0; j < 16; j += 1) {
+        codes[h + j] = u >> (low + 2 * j + 2) & mask;
+      }
+      w->kmer_code = z >> low;
+    }
+    cgr_count_cells(w, codes, SIMD_BLOCK);
+    return;
+  }
+
+  uint32_t cells[SIMD_BLOCK];
+  simd.fixed_cells(
+    (uint64_t)mx << 32 | w->fixed_x, (uint64_t)my << 32 | w->fixed_y, cells
+  );
+  cgr_count_cells(w, cells, SIMD_BLOCK);
+  w->fixed_x = mx;
+  w->fixed_y = my;
+}
+
+// walks SIMD_BLOCK packed bases
+static inline void
+cgr_walk_block_packed(cgr_walker_t* w, uint64_t word)
+{
+  uint32_t mx = 0;
+  uint32_t my = 0;
+  for (int32_t b = 0; b < 8; b += 1) {
+    mx |= (uint32_t)packed_bits_x[word >> (b * 8) & 255] << (b * 4);
+    my |= (uint32_t)packed_bits_y[word >> (b * 8) & 255] << (b * 4);
+  }
+  cgr_walk_block(w, mx, my);
+}
+
+static void
+cgr_walk_bytes(cgr_walker_t* w, uint8_t* buf, int64_t len)
+{
+  for (int64_t k = 0; k < len; k += 1) {
+    uint8_t corner = corner_map[buf[k]];
+    if (corner >= CORNERS_MAX) {
+      if (corner == CORNER_SKIP) continue;
+      cgr_walk_restart(w, corner == CORNER_MASK);
+      continue;
+    }
+
+    cgr_walk_corner(w, corner);
+  }
+}
+
+static void
+cgr_walk(cgr_walker_t* w, uint8_t* buf, int64_t len)
+{
+  int64_t k = 0;
+  if (walk_fixed || kmer_k > 0) {
+    for (; k + SIMD_BLOCK <= len; k += SIMD_BLOCK) {
+      uint32_t mx, my;
+      if (cgr_walk_block_ready(w) && simd.translate(buf + k, &mx, &my)) {
+        cgr_walk_block(w, mx, my);
+      } else {
+        cgr_walk_bytes(w, buf + k, SIMD_BLOCK);
+      }
+    }
+  }
+  cgr_walk_bytes(w, buf + k, len - k);
+}
+
+static void
+cgr_pack_grow(void)
+{
+  int64_t old_words = packed_cap / 32;
+  packed_cap = packed_cap == 0 ? 1 << 20 : packed_cap * 2;
+  int64_t words = packed_cap / 32;
+
+  packed = realloc(packed, sizeof(*packed) * words);
+  packed_amb = realloc(packed_amb, sizeof(*packed_amb) * (words / 64));
+  if (packed == NULL || packed_amb == NULL) {
+    printf("ERROR: cgr_pack_grow: out of memory\n");
+    exit(1);
+  }
+  memset(packed + old_words, 0, sizeof(*packed) * (words - old_words));
+  memset(
+    packed_amb + old_words / 64, 0,
+    sizeof(*packed_amb) * (words / 64 - old_words / 64)
+  );
+}
+
+static inline void
+cgr_pack_push(uint8_t code)
+{
+  if (packed_len == packed_cap) cgr_pack_grow();
+  packed[packed_len / 32] |= (uint64_t)code << (packed_len % 32 * 2);
+  packed_len += 1;
+}
+
+static void
+cgr_pack_event(uint8_t kind)
+{
+  int64_t last = packed_n_events > 0 ? packed_events[packed_n_events - 1] : -1;
+  if (last == packed_len - 1) {
+    int64_t w = last / 32;
+    packed[w] &= ~(3ull << (last % 32 * 2));
+    packed[w] |= (uint64_t)kind << (last % 32 * 2);
+    return;
+  }
+
+  if (packed_n_events == packed_events_cap) {
+    packed_events_cap = packed_events_cap == 0 ? 1024 : packed_events_cap * 2;
+    packed_events = realloc(
+      packed_events, sizeof(*packed_events) * packed_events_cap
+    );
+    if (packed_events == NULL) {
+      printf("ERROR: cgr_pack_event: out of memory\n");
+      exit(1);
+    }
+  }
+
+  int64_t w = packed_len / 32;
+  packed_events[packed_n_events] = packed_len;
+  packed_n_events += 1;
+  cgr_pack_push(kind);
+  packed_amb[w / 64] |= 1ull << (w % 64);
+}
+
+static void
+cgr_pack(uint8_t* buf, int64_t len)
+{
+  for (int64_t k = 0; k < len; k += 1) {
+    uint8_t corner = corner_map[buf[k]];
+    if (corner < CORNERS_MAX) {
+      cgr_pack_push(corner);
+    } else if (corner != CORNER_SKIP) {
+      cgr_pack_event(corner == CORNER_MASK ? PACKED_MASK : PACKED_RESTART);
+    }
+  }
+}
+
+// walks packed bases [from, from + n), `from` only ever moves forward
+static void
+cgr_walk_packed(cgr_walker_t* w, int64_t from, int64_t n)
+{
+  int64_t idx = from;
+  int64_t end = from + n;
+
+  // a walker picked up mid-sample searches for its first event
+  int64_t lo = w->event_idx;
+  int64_t hi = packed_n_events;
+  while (lo < hi) {
+    int64_t mid = lo + (hi - lo) / 2;
+    if (packed_events[mid] < from) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  w->event_idx = lo;
+
+  while (idx < end) {
+    int64_t wi = idx / 32;
+    int32_t off = idx % 32;
+    int32_t cnt = 32 - off;
+    if (cnt > end - idx) cnt = end - idx;
+    uint64_t word = packed[wi] >> (off * 2);
+
+    if ((packed_amb[wi / 64] >> (wi % 64) & 1) == 0) {
+      if (cnt == SIMD_BLOCK && cgr_walk_block_ready(w)) {
+        cgr_walk_block_packed(w, word);
+        idx += cnt;
+        continue;
+      }
+      for (int32_t c = 0; c < cnt; c += 1) {
+        cgr_walk_corner(w, word & 3);
+        word >>= 2;
+      }
+    } else {
+      for (int32_t c = 0; c < cnt; c += 1) {
+        if (
+          w->event_idx < packed_n_events
+          && packed_events[w->event_idx] == idx + c
+        ) {
+          w->event_idx += 1;
+          cgr_walk_restart(w, (word & 3) == PACKED_MASK);
+        } else {
+          cgr_walk_corner(w, word & 3);
+        }
+        word >>= 2;
+      }
+    }
+
+    idx += cnt;
+  }
+}
+
+// one byte of .2bit DNA as our corners, first base in the low bits
+static uint8_t twobit_byte[256] = {0};
+
+static void
+cgr_init_twobit_byte(void)
+{
+  // .2bit order is T, C, A, G
+  uint8_t corner[4] = {3, 1, 0, 2};
+  for (int32_t b = 0; b < 256; b += 1) {
+    uint8_t v = 0;
+    for (int32_t k = 0; k < 4; k += 1) {
+      v |= corner[(b >> (6 - 2 * k)) & 3] << (2 * k);
+    }
+    twobit_byte[b] = v;
+  }
+}
+
+static inline uint32_t
+cgr_u32(uint8_t* p)
+{
+  uint32_t v = 0;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static void
+cgr_walk_twobit_bases(cgr_walker_t* w, uint8_t* dna, int64_t from, int64_t to)
+{
+  int64_t pos = from;
+  while (pos < to && pos % 4 != 0) {
+    cgr_walk_corner(w, twobit_byte[dna[pos / 4]] >> (pos % 4 * 2) & 3);
+    pos += 1;
+  }
+  while (pos + 4 <= to) {
+    if (pos + SIMD_BLOCK <= to && cgr_walk_block_ready(w)) {
+      uint64_t word = 0;
+      for (int32_t b = 0; b < SIMD_BLOCK / 4; b += 1) {
+        word |= (uint64_t)twobit_byte[dna[pos / 4 + b]] << (b * 8);
+      }
+      cgr_walk_block_packed(w, word);
+      pos += SIMD_BLOCK;
+      continue;
+    }
+
+    uint8_t v = twobit_byte[dna[pos / 4]];
+    cgr_walk_corner(w, v & 3);
+    cgr_walk_corner(w, v >> 2 & 3);
+    cgr_walk_corner(w, v >> 4 & 3);
+    cgr_walk_corner(w, v >> 6);
+    pos += 4;
+  }
+  for (; pos < to; pos += 1) {
+    cgr_walk_corner(w, twobit_byte[dna[pos / 4]] >> (pos % 4 * 2) & 3);
+  }
+}
+
+// walks bases [from, to) of one sequence, N blocks go through the N policy
+static void
+cgr_walk_twobit_seq(
+  cgr_walker_t* w, cgr_twobit_seq_t* seq, int64_t from, int64_t to
+)
+{
+  uint8_t policy = class_policy[CGR_CLASS_N];
+
+  // first N block that ends after `from`
+  uint32_t lo = 0;
+  uint32_t hi = seq->n_blocks;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    int64_t end = (int64_t)cgr_u32(seq->n_starts + 4 * mid)
+      + cgr_u32(seq->n_sizes + 4 * mid);
+    if (end <= from) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  int64_t pos = from;
+  uint32_t k = lo;
+  while (pos < to) {
+    int64_t n_start = k < seq->n_blocks ? cgr_u32(seq->n_starts + 4 * k) : to;
+    if (n_start > pos) {
+      int64_t end = n_start < to ? n_start : to;
+      cgr_walk_twobit_bases(w, seq->dna, pos, end);
+      pos = end;
+      continue;
+    }
+
+    int64_t n_end = n_start + cgr_u32(seq->n_sizes + 4 * k);
+    if (policy != CGR_POLICY_SKIP) {
+      cgr_walk_restart(w, policy == CGR_POLICY_MASK);
+    }
+    pos = n_end < to ? n_end : to;
+    k += 1;
+  }
+}
+
+// walks bases [from, from + n) of the selected sequences taken back to
+// back, `from` only ever moves forward
+static void
+cgr_walk_twobit(cgr_walker_t* w, int64_t from, int64_t n)
+{
+  int64_t end = from + n;
+  int64_t pos = from;
+
+  // a walker picked up mid-sample searches for its sequence, the last one
+  // starting at or before `from`
+  int32_t lo = w->seq_idx;
+  int32_t hi = twobit_n_seqs;
+  while (hi - lo > 1) {
+    int32_t mid = lo + (hi - lo) / 2;
+    if (twobit_seqs[mid].start <= from) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  w->seq_idx = lo;
+
+  while (pos < end && w->seq_idx < twobit_n_seqs) {
+    cgr_twobit_seq_t* seq = &twobit_seqs[w->seq_idx];
+    int64_t seq_end = seq->start + seq->len;
+    if (pos >= seq_end) {
+      w->seq_idx += 1;
+      continue;
+    }
+
+    if (pos == seq->start) cgr_walk_restart(w, false);
+    int64_t to = end < seq_end ? end : seq_end;
+    cgr_walk_twobit_seq(w, seq, pos - seq->start, to - seq->start);
+    pos = to;
+  }
+}
+
+// emits the histogram of the record that was being walked when
+// record_out is set, then starts the next one from a clean grid
+static void
+cgr_record_end(cgr_parser_t* p)
+{
+  if (record_out == NULL) return;
+  if (p->records == 0 && p->record_bases == 0) return;
+  cgr_walker_flush(p->w);
+
+  p->name[p->name_len] = '\0';
+  cgr_write_grid_counts(record_out, p->name);
+  cgr_clear_grid();
+}
+
+// a `>` line starts a new record: the walk restarts at the center so that
+// contigs do not bleed into each other
+static void
+cgr_record_begin(cgr_parser_t* p)
+{
+  cgr_record_end(p);
+
+  if (parse_pack) {
+    if (packed_len > 0) cgr_pack_event(PACKED_RESTART);
+  } else {
+    cgr_walk_restart(p->w, false);
+  }
+  p->records += 1;
+  p->record_bases = 0;
+  p->name_len = 0;
+  p->in_name = true;
+}
+
+// the record name is the header up to the first whitespace
+static void
+cgr_parse_name(cgr_parser_t* p, uint8_t* cur, uint8_t* end)
+{
+  for (; cur < end; cur += 1) {
+    if (isspace(*cur)) {
+      p->in_name = false;
+      return;
+    }
+    if (p->name_len < (int32_t)sizeof(p->name) - 1) {
+      p->name[p->name_len] = *cur;
+      p->name_len += 1;
+    }
+  }
+}
+
+static void
+cgr_parse_emit(cgr_parser_t* p, uint8_t* buf, int64_t len)
+{
+  if (parse_pack) {
+    cgr_pack(buf, len);
+  } else {
+    cgr_walk(p->w, buf, len);
+  }
+  p->record_bases += len;
+}
+
+static void
+cgr_fastq_hold(cgr_parser_t* p, uint8_t* buf, int64_t len)
+{
+  if (p->fastq_seq_len + len > fastq_seq_cap) {
+    while (p->fastq_seq_len + len > fastq_seq_cap) {
+      fastq_seq_cap = fastq_seq_cap == 0 ? 1024 : fastq_seq_cap * 2;
+    }
+    fastq_seq = realloc(fastq_seq, fastq_seq_cap);
+    if (fastq_seq == NULL) {
+      printf("ERROR: cgr_fastq_hold: out of memory\n");
+      exit(1);
+    }
+  }
+
+  memcpy(fastq_seq + p->fastq_seq_len, buf, len);
+  p->fastq_seq_len += len;
+}
+
+// walks the held bases that `qual` covers, low quality ones as N
+static void
+cgr_fastq_qual(cgr_parser_t* p, uint8_t* qual, int64_t len)
+{
+  uint8_t* seq = fastq_seq + p->fastq_qual_len;
+  int64_t n = p->fastq_seq_len - p->fastq_qual_len;
+  if (n > len) n = len;
+
+  for (int64_t i = 0; i < n; i += 1) {
+    if (qual[i] - 33 < min_qual) seq[i] = 'N';
+  }
+  cgr_parse_emit(p, seq, n);
+  p->fastq_qual_len += n;
+}
+
+// FASTQ: four lines per read (header, sequence, `+`, quality), each read
+// is its own record and walk
+static void
+cgr_parse_fastq(cgr_parser_t* p, uint8_t* buf, int64_t len)
+{
+  uint8_t* cur = buf;
+  uint8_t* end = buf + len;
+
+  while (cur < end) {
+    if (p->line_start && p->fastq_line == FASTQ_HEADER) {
+      if (*cur == '\n' || *cur == '\r') {
+        cur += 1;
+        continue;
+      }
+      if (*cur != '@') {
+        printf("ERROR: cgr_parse_fastq: expected `@` at the start of a read\n");
+        exit(1);
+      }
+      cgr_record_begin(p);
+      cur += 1;
+    }
+
+    uint8_t* nl = memchr(cur, '\n', end - cur);
+    uint8_t* line_end = nl != NULL ? nl : end;
+    uint8_t* run_end = line_end;
+    while (run_end > cur && run_end[-1] == '\r') run_end -= 1;
+
+    switch (p->fastq_line) {
+    case FASTQ_HEADER:
+      if (p->in_name) cgr_parse_name(p, cur, line_end);
+      break;
+    case FASTQ_SEQ:
+      if (min_qual > 0) {
+        cgr_fastq_hold(p, cur, run_end - cur);
+      } else {
+        cgr_parse_emit(p, cur, run_end - cur);
+      }
+      break;
+    case FASTQ_QUAL:
+      if (min_qual > 0) cgr_fastq_qual(p, cur, run_end - cur);
+      break;
+    }
+
+    if (nl == NULL) {
+      p->line_start = false;
+      return;
+    }
+
+    p->line_start = true;
+    p->in_name = false;
+    p->fastq_line = (p->fastq_line + 1) % 4;
+    if (p->fastq_line == FASTQ_SEQ) {
+      p->fastq_seq_len = 0;
+      p->fastq_qual_len = 0;
+    }
+    cur = nl + 1;
+  }
+}
+
+// FASTA and multi-FASTA: `>` (or `;`) lines are headers, everything else
+// is sequence split over lines with LF or CRLF endings; raw sequence with no
+// header is accepted as is. Runs of sequence between line breaks are fed to
+// cgr_walk directly, the line breaks are found with memchr which glibc
+// vectorizes, so the cost per byte is dominated by the walk itself. Input
+// starting with `@` is FASTQ
+static void
+cgr_parse(cgr_parser_t* p, uint8_t* buf, int64_t len)
+{
+  if (len == 0) return;
+  if (!p->sniffed) {
+    p->sniffed = true;
+    p->fastq = buf[0] == '@';
+  }
+  if (p->fastq) {
+    cgr_parse_fastq(p, buf, len);
+    return;
+  }
+
+  uint8_t* cur = buf;
+  uint8_t* end = buf + len;
+
+  while (cur < end) {
+    if (p->line_start && (*cur == '>' || *cur == ';')) {
+      p->in_header = true;
+      if (*cur == '>') {
+        cgr_record_begin(p);
+        cur += 1;
+      }
+    }
+
+    uint8_t* nl = memchr(cur, '\n', end - cur);
+    uint8_t* line_end = nl != NULL ? nl : end;
+
+    if (p->in_header) {
+      if (p->in_name) cgr_parse_name(p, cur, line_end);
+    } else {
+      uint8_t* run_end = line_end;
+      while (run_end > cur && run_end[-1] == '\r') run_end -= 1;
+      cgr_parse_emit(p, cur, run_end - cur);
+    }
+
+    if (nl == NULL) {
+      p->line_start = false;
+      return;
+    }
+
+    p->line_start = true;
+    p->in_header = false;
+    p->in_name = false;
+    cur = nl + 1;
+  }
+}
+
+// walks [from, from + n) of the loaded sample, in bytes for text and in
+// bases for packed and .2bit samples
+static void
+cgr_walk_sample(cgr_parser_t* p, int64_t from, int64_t n)
+{
+  if (twobit_map != NULL) {
+    cgr_walk_twobit(p->w, from, n);
+  } else if (packed != NULL) {
+    cgr_walk_packed(p->w, from, n);
+  } else {
+    cgr_parse(p, data + from, n);
+  }
+}
+
+// with --sweep the window walks every ratio R steps through at once: each
+// stretch of the sample is walked at one ratio after the other while it
+// is still in cache, so R swaps in a grid that is as far along as the one
+// on screen instead of starting over. The ratio on screen is walked by
+// `walker` into grid_counts like any other walk, the others wait in their
+// slots
+#define SWEEP_MAX 16
+#define SWEEP_CHUNK (1 << 18)
+
+typedef struct {
+  float ratio;
+  cgr_walker_t w;
+  cgr_parser_t p;
+  int64_t* counts;
+} cgr_sweep_slot_t;
+
+static cgr_sweep_slot_t sweep_slots[SWEEP_MAX] = {0};
+static int32_t sweep_n = 0;
+static int32_t sweep_shown = 0;
+
+// the ratios R goes through from the starting one, the starting one being
+// on screen
+static void
+cgr_init_sweep(void)
+{
+  float ratio = jump_ratio;
+  for (;;) {
+    cgr_sweep_slot_t* s = &sweep_slots[sweep_n];
+    s->ratio = ratio;
+    if (sweep_n > 0) {
+      s->counts = calloc((size_t)grid_n * grid_n, sizeof(*s->counts));
+      if (s->counts == NULL) {
+        printf("ERROR: cgr_init_sweep: out of memory\n");
+        exit(1);
+      }
+      cgr_walker_init(&s->w, s->counts);
+      s->p = (cgr_parser_t){.w = &s->w, .line_start = true};
+    }
+    sweep_n += 1;
+
+    if (ratio >= 1.0f || sweep_n == SWEEP_MAX) break;
+    ratio = fminf(ratio + 0.1f, 1.0f);
+  }
+  sweep_shown = 0;
+}
+
+static void
+cgr_free_sweep(void)
+{
+  for (int32_t i = 0; i < sweep_n; i += 1) {
+    if (i == sweep_shown) continue;
+    cgr_walker_free(&sweep_slots[i].w);
+    free(sweep_slots[i].counts);
+  }
+  sweep_n = 0;
+}
+
+// walks [from, from + n) at every ratio, SWEEP_CHUNK at a time
+static void
+cgr_sweep_walk(int64_t from, int64_t n)
+{
+  float shown = jump_ratio;
+  for (int64_t at = from; at < from + n; at += SWEEP_CHUNK) {
+    int64_t m = from + n - at < SWEEP_CHUNK ? from + n - at : SWEEP_CHUNK;
+    for (int32_t i = 0; i < sweep_n; i += 1) {
+      cgr_sweep_slot_t* s = &sweep_slots[i];
+      cgr_parser_t* p = i == sweep_shown ? &parser : &s->p;
+      cgr_set_ratio(s->ratio);
+      cgr_walk_sample(p, at, m);
+      cgr_walker_flush(p->w);
+    }
+  }
+  cgr_set_ratio(shown);
+}
+
+// puts the next ratio on screen, wrapping around after the last
+static void
+cgr_sweep_next(void)
+{
+  cgr_sweep_slot_t* old = &sweep_slots[sweep_shown];
+  old->w = walker;
+  old->p = parser;
+  old->p.w = &old->w;
+  old->counts = grid_counts;
+
+  sweep_shown = (sweep_shown + 1) % sweep_n;
+  cgr_sweep_slot_t* s = &sweep_slots[sweep_shown];
+  walker = s->w;
+  parser = s->p;
+  parser.w = &walker;
+  grid_counts = s->counts;
+  cgr_set_ratio(s->ratio);
+  cgr_mark_grid_dirty();
+}
+
+// the walk can be picked up anywhere when the state at a point can be
+// recovered exactly: at ratio 0.5 the fixed point position is just the last
+// 32 bases and a k-mer code the last k, so walking a stretch before the
+// point without counting, until enough bases or a restart were seen, puts
+// the walker where the full walk would have been
+#define WARMUP_BASES 32
+#define WARMUP_MIN 4096
+
+// a text split point must not fall inside a header or comment line, since
+// the parser would take the rest of it for bases: such points move back to
+// the start of their line. Headers are taken to be shorter than
+// SPLIT_LINE_MAX, so a point that far from any newline is in a sequence
+// line and splitting never scans the whole sample
+#define SPLIT_LINE_MAX (1 << 16)
+
+static int64_t
+cgr_walk_split(int64_t pos)
+{
+  if (twobit_map != NULL || packed != NULL || pos == 0) return pos;
+
+  int64_t back = pos < SPLIT_LINE_MAX ? pos : SPLIT_LINE_MAX;
+  uint8_t* nl = memrchr(data + pos - back, '\n', back);
+  if (nl == NULL && back < pos) return pos;
+  int64_t line = nl != NULL ? nl - data + 1 : 0;
+  if (data[line] == '>' || data[line] == ';') return line;
+  return pos;
+}
+
+static void
+cgr_walk_begin(cgr_parser_t* p, int64_t pos)
+{
+  *p = (cgr_parser_t){
+    .w = p->w,
+    .sniffed = true,
+    .line_start = pos == 0 || twobit_map != NULL || packed != NULL
+      || data[pos - 1] == '\n',
+  };
+}
+
+static void
+cgr_walk_warmup(cgr_parser_t* p, int64_t to, int64_t* counts)
+{
+  cgr_walker_t* w = p->w;
+  for (int64_t back = WARMUP_MIN;; back *= 2) {
+    int64_t from = to > back ? to - back : 0;
+    from = cgr_walk_split(from);
+    cgr_walker_init(w, counts);
+    w->counting = false;
+    cgr_walk_begin(p, from);
+    cgr_walk_sample(p, from, to - from);
+    if (from == 0 || w->restarted || w->bases >= WARMUP_BASES) break;
+  }
+  w->counting = true;
+}
+
+// FASTQ cannot be entered mid-file: a line alone does not say whether it
+// holds bases or qualities
+static bool
+cgr_walk_seekable(void)
+{
+  if (twobit_map != NULL || packed != NULL) return true;
+  return data_len > 0 && data[0] != '@';
+}
+
+static bool
+cgr_zoom_ok(void)
+{
+  // while sweeping the producer switches walk_fixed between ratios, it
+  // is not read at all then
+  if (sweep_n > 0) return false;
+  return walk_fixed && kmer_k == 0 && cgr_walk_seekable();
+}
+
+// one walk over the whole sample, on the first zoom. Nothing is hidden
+// after masks, so the index holds every point a view could count at any
+// depth
+static void
+cgr_zoom_index(void)
+{
+  zoom_n_chunks = (data_len + ZOOM_CHUNK - 1) / ZOOM_CHUNK;
+  zoom_offsets = malloc(sizeof(*zoom_offsets) * (zoom_n_chunks + 1));
+  zoom_todo = calloc((zoom_n_chunks + 63) / 64, sizeof(*zoom_todo));
+  zoom_want = malloc(sizeof(*zoom_want) << (2 * ZOOM_INDEX_K - 6));
+  if (zoom_offsets == NULL || zoom_todo == NULL || zoom_want == NULL) {
+    printf("ERROR: cgr_zoom_index: out of memory\n");
+    exit(1);
+  }
+
+  int32_t mask = mask_steps;
+  mask_steps = 0;
+  zoom_indexing = true;
+
+  cgr_walker_t w;
+  cgr_walker_init(&w, NULL);
+  cgr_parser_t p = {.w = &w, .line_start = true};
+  for (int64_t c = 0; c < zoom_n_chunks; c += 1) {
+    int64_t from = c * ZOOM_CHUNK;
+    int64_t n = data_len - from < ZOOM_CHUNK ? data_len - from : ZOOM_CHUNK;
+    zoom_offsets[c] = zoom_cells_len;
+    cgr_walk_sample(&p, from, n);
+  }
+  zoom_offsets[zoom_n_chunks] = zoom_cells_len;
+
+  zoom_indexing = false;
+  mask_steps = mask;
+  zoom_indexed = true;
+}
+
+// marks the chunks with a point under the view
+static void
+cgr_zoom_plan(void)
+{
+  int32_t shift = 32 - ZOOM_INDEX_K;
+  uint64_t side = 1ull << (32 - zoom_depth);
+  uint32_t x0 = zoom_x >> shift;
+  uint32_t y0 = zoom_y >> shift;
+  uint32_t x1 = (zoom_x + side - 1) >> shift;
+  uint32_t y1 = (zoom_y + side - 1) >> shift;
+
+  memset(zoom_want, 0, sizeof(*zoom_want) << (2 * ZOOM_INDEX_K - 6));
+  for (uint32_t y = y0; y <= y1; y += 1) {
+    for (uint32_t x = x0; x <= x1; x += 1) {
+      uint32_t cell = y << ZOOM_INDEX_K | x;
+      zoom_want[cell / 64] |= 1ull << (cell % 64);
+    }
+  }
+
+  memset(zoom_todo, 0, sizeof(*zoom_todo) * ((zoom_n_chunks + 63) / 64));
+  for (int64_t c = 0; c < zoom_n_chunks; c += 1) {
+    for (int64_t e = zoom_offsets[c]; e < zoom_offsets[c + 1]; e += 1) {
+      uint32_t cell = zoom_cells[e];
+      if (zoom_want[cell / 64] >> (cell % 64) & 1) {
+        zoom_todo[c / 64] |= 1ull << (c % 64);
+        break;
+      }
+    }
+  }
+}
+
+// walks up to `steps` of the chunks planned for the view, jumping over
+// the others
+static void
+cgr_zoom_step(int64_t steps)
+{
+  if (!zoom_indexed) cgr_zoom_index();
+  if (!zoom_planned) {
+    cgr_zoom_plan();
+    zoom_planned = true;
+  }
+
+  while (steps > 0 && data_idx < data_len) {
+    int64_t c = data_idx / ZOOM_CHUNK;
+    if ((zoom_todo[c / 64] >> (c % 64) & 1) == 0) {
+      c += 1;
+      while (c < zoom_n_chunks && (zoom_todo[c / 64] >> (c % 64) & 1) == 0) {
+        c += 1;
+      }
+      data_idx = c < zoom_n_chunks ? c * ZOOM_CHUNK : data_len;
+      zoom_cold = true;
+      continue;
+    }
+
+    if (zoom_cold) {
+      int64_t max = walker.max;
+      cgr_walker_free(&walker);
+      cgr_walk_warmup(&parser, data_idx, grid_counts);
+      walker.max = max;
+      zoom_cold = false;
+    }
+
+    int64_t n = (c + 1) * ZOOM_CHUNK;
+    if (n > data_len) n = data_len;
+    n -= data_idx;
+    if (n > steps) n = steps;
+    cgr_walk_sample(&parser, data_idx, n);
+    data_idx += n;
+    steps -= n;
+  }
+}
+
+// starts the walk over for a view, a depth of 0 being the whole grid.
+// Deeper views see finer detail of the center after a mask, so hide more
+static void
+cgr_zoom_to(int32_t depth, int64_t x, int64_t y)
+{
+  int64_t far = (1ll << 32) - (1ll << (32 - depth));
+  zoom_on = depth > 0;
+  zoom_depth = depth;
+  zoom_x = x < 0 ? 0 : x > far ? far : x;
+  zoom_y = y < 0 ? 0 : y > far ? far : y;
+  zoom_planned = false;
+  zoom_cold = false;
+  mask_steps = (int32_t)ceilf(logf(grid_n) / -logf(1.0f - jump_ratio)) + depth;
+
+  cgr_clear_grid();
+  cgr_walker_free(&walker);
+  cgr_walker_init(&walker, grid_counts);
+  parser = (cgr_parser_t){.w = &walker, .line_start = true};
+  data_idx = 0;
+}
+
+// the wheel zooms 2x about the cursor, dragging the grid pans it once the
+// button is let go; returns whether the view changed
+static bool
+cgr_zoom_input(int32_t* depth, int64_t* x, int64_t* y)
+{
+  static bool dragging = false;
+  static Vector2 drag_from = {0};
+
+  Vector2 m = GetMousePosition();
+  float fx = (m.x - grid_pos.x) / GRID_W;
+  float fy = (m.y - grid_pos.y) / GRID_H;
+  bool over = fx >= 0.0f && fx < 1.0f && fy >= 0.0f && fy < 1.0f;
+  int64_t side = 1ll << (32 - zoom_depth);
+  float wheel = GetMouseWheelMove();
+
+  *depth = zoom_depth;
+  *x = zoom_x;
+  *y = zoom_y;
+  if (over && wheel > 0.0f && zoom_depth < ZOOM_DEPTH_MAX) {
+    *depth += 1;
+    *x += (int64_t)(fx * side / 2);
+    *y += (int64_t)(fy * side / 2);
+    return true;
+  }
+  if (over && wheel < 0.0f && zoom_depth > 0) {
+    *depth -= 1;
+    *x -= (int64_t)(fx * side);
+    *y -= (int64_t)(fy * side);
+    return true;
+  }
+
+  if (over && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+    dragging = true;
+    drag_from = m;
+  }
+  if (dragging && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+    dragging = false;
+    Vector2 d = Vector2Subtract(m, drag_from);
+    if (zoom_depth == 0 || (d.x == 0.0f && d.y == 0.0f)) return false;
+    *x -= (int64_t)(d.x / GRID_W * side);
+    *y -= (int64_t)(d.y / GRID_H * side);
+    return true;
+  }
+
+  return false;
+}
+
+static void
+cgr_vis_step(int64_t steps)
+{
+  if (!data_vis) return;
+  if (zoom_on) {
+    cgr_zoom_step(steps);
+    return;
+  }
+
+  int64_t n = data_len - data_idx;
+  if (n > steps) n = steps;
+
+  if (sweep_n > 0) {
+    cgr_sweep_walk(data_idx, n);
+  } else {
+    cgr_walk_sample(&parser, data_idx, n);
+    cgr_walker_flush(&walker);
+  }
+  data_idx += n;
+}
+
+// walks in the background while the window is open, publishing whenever
+// the window has caught up with the last snapshot
+static void*
+cgr_produce(void* arg)
+{
+  (void)arg;
+  bool pending = true;
+  while (!atomic_load(&producer_quit)) {
+    if (data_vis && data_idx < data_len) {
+      cgr_vis_step(PRODUCER_STEPS);
+      pending = true;
+    } else {
+      usleep(PRODUCER_IDLE_US);
+    }
+    if (pending) pending = !cgr_publish();
+  }
+
+  return NULL;
+}
+
+static void
+cgr_start_producer(void)
+{
+  atomic_store(&producer_quit, false);
+  if (pthread_create(&producer, NULL, cgr_produce, NULL) != 0) {
+    printf("ERROR: cgr_start_producer: could not start the walk thread\n");
+    exit(1);
+  }
+}
+
+static void
+cgr_stop_producer(void)
+{
+  atomic_store(&producer_quit, true);
+  pthread_join(producer, NULL);
+}
+
+// with --sync the walk shares the frame with drawing. The batch is resized
+// every frame from the measured walk rate so that walking plus last frame's
+// drawing fills FRAME_SHARE of a refresh, growing or shrinking at most 2x a
+// frame. --fast spends the whole rest of the frame walking in FAST_SLICE
+// batches instead
+#define FRAME_SHARE 0.85
+#define FAST_SLICE (1 << 16)
+
+static int64_t vis_steps = VIS_STEPS_PER_ITER;
+
+static void
+cgr_sync_walk(double frame_s, double draw_s, bool fast)
+{
+  double budget = frame_s * (fast ? 1.0 : FRAME_SHARE) - draw_s;
+  if (budget < 0.001) budget = 0.001;
+
+  double start = GetTime();
+  if (fast) {
+    while (data_vis && data_idx < data_len && GetTime() - start < budget) {
+      cgr_vis_step(FAST_SLICE);
+    }
+    return;
+  }
+
+  int64_t from = data_idx;
+  cgr_vis_step(vis_steps);
+  double took = GetTime() - start;
+
+  // a batch cut short by the end of the sample says nothing about the rate
+  if (data_idx - from < vis_steps || took <= 0.0) return;
+
+  int64_t next = (int64_t)(vis_steps * (budget / took));
+  if (next > vis_steps * 2) next = vis_steps * 2;
+  if (next < vis_steps / 2) next = vis_steps / 2;
+  if (next < VIS_STEPS_MIN) next = VIS_STEPS_MIN;
+  if (next > VIS_STEPS_MAX) next = VIS_STEPS_MAX;
+  vis_steps = next;
+}
+
+static void
+cgr_draw_debug_info(cgr_snapshot_t* snap)
+{
+  {
+    char buf[32] = {0};
+    snprintf(
+      buf, sizeof(buf), "vis: %6.2f%%",
+      (double)snap->idx / data_len * 100.0
+    );
+    DrawText(buf, 10.0f, 10.0f, 20.0f, GRAY);
+  }
+  {
+    char buf[32] = {0};
+    if (kmer_k > 0) {
+      snprintf(buf, sizeof(buf), "k: %d", kmer_k);
+    } else if (sweep_n > 0) {
+      snprintf(buf, sizeof(buf), "ratio: %4.2f", sweep_slots[sweep_shown].ratio);
+    } else {
+      snprintf(buf, sizeof(buf), "ratio: %4.2f", jump_ratio);
+    }
+    DrawText(buf, 10.0f, 30.0f, 20.0f, GRAY);
+  }
+  if (zoom_depth > 0) {
+    char buf[32] = {0};
+    snprintf(buf, sizeof(buf), "zoom: %dx", 1 << zoom_depth);
+    DrawText(buf, 10.0f, 50.0f, 20.0f, GRAY);
+  }
+}
+
+// bytes pulled from `fd` while sniffing the format are handed out again
+// first, so the same path works for files and for pipes
+typedef struct {
+  int fd;
+  uint8_t head[BGZF_HEADER_LEN];
+  int32_t head_len;
+  int32_t head_pos;
+} cgr_reader_t;
+
+// where decompressed (or plain) input goes: the parser when streaming, the
+// in-memory sample buffer otherwise
+typedef void (*cgr_sink_t)(uint8_t* buf, int64_t len);
+
+static int64_t
+cgr_read_fd(int fd, uint8_t* buf, int64_t len)
+{
+  int64_t n = 0;
+  while (n < len) {
+    ssize_t read_len = read(fd, buf + n, len - n);
+    if (read_len < 0) {
+      if (errno == EINTR) continue;
+      printf("ERROR: cgr_read_fd: %s\n", strerror(errno));
+      exit(1);
+    }
+    if (read_len == 0) break;
+    n += read_len;
+  }
+
+  return n;
+}
+
+// reads up to `len` bytes, short only at end of input
+static int64_t
+cgr_reader_read(cgr_reader_t* r, uint8_t* buf, int64_t len)
+{
+  int64_t n = 0;
+  while (n < len && r->head_pos < r->head_len) {
+    buf[n] = r->head[r->head_pos];
+    n += 1;
+    r->head_pos += 1;
+  }
+
+  return n + cgr_read_fd(r->fd, buf + n, len - n);
+}
+
+static void
+cgr_sink_parse(uint8_t* buf, int64_t len)
+{
+  cgr_parse(&parser, buf, len);
+}
+
+static size_t data_cap = 0;
+
+static void
+cgr_sink_append(uint8_t* buf, int64_t len)
+{
+  if ((size_t)(data_len + len) > data_cap) {
+    if (data_cap == 0) data_cap = 1 << 20;
+    while ((size_t)(data_len + len) > data_cap) data_cap *= 2;
+    data = realloc(data, data_cap);
+    if (data == NULL) {
+      printf("ERROR: cgr_sink_append: out of memory\n");
+      exit(1);
+    }
+  }
+
+  memcpy(data + data_len, buf, len);
+  data_len += len;
+}
+
+static int64_t
+cgr_pump_plain(cgr_reader_t* r, cgr_sink_t sink)
+{
+  uint8_t* buf = malloc(SAMPLE_STREAM_CHUNK);
+  if (buf == NULL) {
+    printf("ERROR: cgr_pump_plain: out of memory\n");
+    exit(1);
+  }
+
+  int64_t total = 0;
+  for (;;) {
+    int64_t n = cgr_reader_read(r, buf, SAMPLE_STREAM_CHUNK);
+    if (n == 0) break;
+    sink(buf, n);
+    total += n;
+  }
+
+  free(buf);
+  return total;
+}
+
+// plain gzip, possibly several concatenated members; a deflate stream can
+// only be inflated front to back so this runs on the calling thread
+static int64_t
+cgr_pump_gzip(cgr_reader_t* r, cgr_sink_t sink)
+{
+  z_stream zs = {0};
+  if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+    printf("ERROR: cgr_pump_gzip: inflateInit2 failed\n");
+    exit(1);
+  }
+
+  uint8_t* in = malloc(GZIP_IN_CHUNK);
+  uint8_t* out = malloc(SAMPLE_STREAM_CHUNK);
+  if (in == NULL || out == NULL) {
+    printf("ERROR: cgr_pump_gzip: out of memory\n");
+    exit(1);
+  }
+
+  int64_t total = 0;
+  bool in_member = false;
+  for (;;) {
+    if (zs.avail_in == 0) {
+      int64_t n = cgr_reader_read(r, in, GZIP_IN_CHUNK);
+      if (n == 0) break;
+      zs.next_in = in;
+      zs.avail_in = (uInt)n;
+    }
+
+    zs.next_out = out;
+    zs.avail_out = SAMPLE_STREAM_CHUNK;
+    int ret = inflate(&zs, Z_NO_FLUSH);
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+      printf("ERROR: cgr_pump_gzip: %s\n", zs.msg ? zs.msg : "bad data");
+      exit(1);
+    }
+    in_member = true;
+
+    int64_t n = SAMPLE_STREAM_CHUNK - zs.avail_out;
+    if (n > 0) {
+      sink(out, n);
+      total += n;
+    }
+
+    if (ret == Z_STREAM_END) {
+      inflateReset(&zs);
+      in_member = false;
+    }
+  }
+
+  if (in_member) {
+    printf("ERROR: cgr_pump_gzip: truncated input\n");
+    exit(1);
+  }
+
+  inflateEnd(&zs);
+  free(in);
+  free(out);
+  return total;
+}
+
+// BGZF is gzip cut into independent members of at most 64 KiB with the
+// compressed size stored in a `BC` extra subfield, so a batch of blocks can
+// be read ahead and inflated by a pool of threads while the previous batch
+// is handed to the sink in order
+typedef struct {
+  uint8_t* in;
+  int32_t in_len;
+  uint8_t* out;
+  int32_t out_len;
+  char* err;
+} cgr_bgzf_block_t;
+
+typedef struct {
+  cgr_bgzf_block_t blocks[BGZF_BATCH_BLOCKS];
+  int32_t n_blocks;
+  uint8_t* in_buf;
+  uint8_t* out_buf;
+} cgr_bgzf_batch_t;
+
+static struct {
+  pthread_mutex_t mu;
+  pthread_cond_t work;
+  pthread_cond_t done;
+  cgr_bgzf_batch_t* batch;
+  int32_t next;
+  int32_t pending;
+  bool quit;
+} bgzf_pool = {
+  .mu = PTHREAD_MUTEX_INITIALIZER,
+  .work = PTHREAD_COND_INITIALIZER,
+  .done = PTHREAD_COND_INITIALIZER,
+};
+
+static int32_t n_threads = 0;
+
+static bool
+cgr_is_bgzf(uint8_t* h, int32_t len)
+{
+  return len >= BGZF_HEADER_LEN
+    && h[0] == 0x1f && h[1] == 0x8b && h[2] == 8 && (h[3] & 4) != 0
+    && (h[10] | h[11] << 8) >= 6
+    && h[12] == 'B' && h[13] == 'C' && (h[14] | h[15] << 8) == 2;
+}
+
+static void
+cgr_bgzf_inflate(z_stream* zs, cgr_bgzf_block_t* b)
+{
+  int32_t xlen = b->in[10] | b->in[11] << 8;
+  int32_t payload = 12 + xlen;
+  if (b->in_len < payload + 8) {
+    b->err = "block too short";
+    return;
+  }
+
+  uint8_t* trailer = b->in + b->in_len - 8;
+  uint32_t crc = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (uint32_t)trailer[3] << 24;
+  uint32_t isize = trailer[4] | trailer[5] << 8 | trailer[6] << 16 | (uint32_t)trailer[7] << 24;
+  if (isize > BGZF_BLOCK_MAX) {
+    b->err = "block too big";
+    return;
+  }
+
+  inflateReset(zs);
+  zs->next_in = b->in + payload;
+  zs->avail_in = b->in_len - payload - 8;
+  zs->next_out = b->out;
+  zs->avail_out = BGZF_BLOCK_MAX;
+  if (inflate(zs, Z_FINISH) != Z_STREAM_END) {
+    b->err = zs->msg ? zs->msg : "bad deflate data";
+    return;
+  }
+
+  b->out_len = BGZF_BLOCK_MAX - zs->avail_out;
+  if ((uint32_t)b->out_len != isize || crc32(0, b->out, b->out_len) != crc) {
+    b->err = "checksum mismatch";
+  }
+}
+
+static void*
+cgr_bgzf_worker(void* arg)
+{
+  (void)arg;
+
+  z_stream zs = {0};
+  if (inflateInit2(&zs, -15) != Z_OK) {
+    printf("ERROR: cgr_bgzf_worker: inflateInit2 failed\n");
+    exit(1);
+  }
+
+  pthread_mutex_lock(&bgzf_pool.mu);
+  for (;;) {
+    while (!bgzf_pool.quit
+      && (bgzf_pool.batch == NULL || bgzf_pool.next >= bgzf_pool.batch->n_blocks)) {
+      pthread_cond_wait(&bgzf_pool.work, &bgzf_pool.mu);
+    }
+    if (bgzf_pool.quit) break;
+
+    cgr_bgzf_block_t* b = &bgzf_pool.batch->blocks[bgzf_pool.next];
+    bgzf_pool.next += 1;
+    pthread_mutex_unlock(&bgzf_pool.mu);
+
+    cgr_bgzf_inflate(&zs, b);
+
+    pthread_mutex_lock(&bgzf_pool.mu);
+    bgzf_pool.pending -= 1;
+    if (bgzf_pool.pending == 0) pthread_cond_signal(&bgzf_pool.done);
+  }
+  pthread_mutex_unlock(&bgzf_pool.mu);
+
+  inflateEnd(&zs);
+  return NULL;
+}
+
+static void
+cgr_bgzf_submit(cgr_bgzf_batch_t* batch)
+{
+  pthread_mutex_lock(&bgzf_pool.mu);
+  bgzf_pool.batch = batch;
+  bgzf_pool.next = 0;
+  bgzf_pool.pending = batch->n_blocks;
+  pthread_cond_broadcast(&bgzf_pool.work);
+  pthread_mutex_unlock(&bgzf_pool.mu);
+}
+
+static void
+cgr_bgzf_wait(void)
+{
+  pthread_mutex_lock(&bgzf_pool.mu);
+  while (bgzf_pool.pending > 0) {
+    pthread_cond_wait(&bgzf_pool.done, &bgzf_pool.mu);
+  }
+  bgzf_pool.batch = NULL;
+  pthread_mutex_unlock(&bgzf_pool.mu);
+}
+
+// reads whole blocks until the batch is full or the input ends
+static void
+cgr_bgzf_fill(cgr_reader_t* r, cgr_bgzf_batch_t* batch)
+{
+  batch->n_blocks = 0;
+  while (batch->n_blocks < BGZF_BATCH_BLOCKS) {
+    cgr_bgzf_block_t* b = &batch->blocks[batch->n_blocks];
+    b->in = batch->in_buf + (size_t)batch->n_blocks * BGZF_BLOCK_MAX;
+    b->out = batch->out_buf + (size_t)batch->n_blocks * BGZF_BLOCK_MAX;
+    b->out_len = 0;
+    b->err = NULL;
+
+    int64_t n = cgr_reader_read(r, b->in, BGZF_HEADER_LEN);
+    if (n == 0) return;
+    if (!cgr_is_bgzf(b->in, n)) {
+      printf("ERROR: cgr_bgzf_fill: not a BGZF block\n");
+      exit(1);
+    }
+
+    int32_t bsize = (b->in[16] | b->in[17] << 8) + 1;
+    if (bsize < BGZF_HEADER_LEN) {
+      printf("ERROR: cgr_bgzf_fill: bad block size\n");
+      exit(1);
+    }
+    n = cgr_reader_read(r, b->in + BGZF_HEADER_LEN, bsize - BGZF_HEADER_LEN);
+    if (n != bsize - BGZF_HEADER_LEN) {
+      printf("ERROR: cgr_bgzf_fill: truncated input\n");
+      exit(1);
+    }
+
+    b->in_len = bsize;
+    batch->n_blocks += 1;
+  }
+}
+
+static int64_t
+cgr_bgzf_emit(cgr_bgzf_batch_t* batch, cgr_sink_t sink)
+{
+  int64_t total = 0;
+  for (int32_t i = 0; i < batch->n_blocks; i += 1) {
+    cgr_bgzf_block_t* b = &batch->blocks[i];
+    if (b->err != NULL) {
+      printf("ERROR: cgr_bgzf_emit: %s\n", b->err);
+      exit(1);
+    }
+    if (b->out_len > 0) sink(b->out, b->out_len);
+    total += b->out_len;
+  }
+
+  return total;
+}
+
+static int64_t
+cgr_pump_bgzf(cgr_reader_t* r, cgr_sink_t sink)
+{
+  cgr_bgzf_batch_t* batches = calloc(2, sizeof(*batches));
+  if (batches == NULL) {
+    printf("ERROR: cgr_pump_bgzf: out of memory\n");
+    exit(1);
+  }
+  for (int32_t i = 0; i < 2; i += 1) {
+    batches[i].in_buf = malloc((size_t)BGZF_BATCH_BLOCKS * BGZF_BLOCK_MAX);
+    batches[i].out_buf = malloc((size_t)BGZF_BATCH_BLOCKS * BGZF_BLOCK_MAX);
+    if (batches[i].in_buf == NULL || batches[i].out_buf == NULL) {
+      printf("ERROR: cgr_pump_bgzf: out of memory\n");
+      exit(1);
+    }
+  }
+
+  pthread_t* threads = malloc(sizeof(*threads) * n_threads);
+  bgzf_pool.quit = false;
+  for (int32_t i = 0; i < n_threads; i += 1) {
+    if (pthread_create(&threads[i], NULL, cgr_bgzf_worker, NULL) != 0) {
+      printf("ERROR: cgr_pump_bgzf: pthread_create failed\n");
+      exit(1);
+    }
+  }
+
+  int64_t total = 0;
+  cgr_bgzf_batch_t* cur = &batches[0];
+  cgr_bgzf_batch_t* next = &batches[1];
+  cgr_bgzf_fill(r, cur);
+  cgr_bgzf_submit(cur);
+  while (cur->n_blocks > 0) {
+    cgr_bgzf_fill(r, next);
+    cgr_bgzf_wait();
+    if (next->n_blocks > 0) cgr_bgzf_submit(next);
+    total += cgr_bgzf_emit(cur, sink);
+
+    cgr_bgzf_batch_t* t = cur;
+    cur = next;
+    next = t;
+  }
+  cgr_bgzf_wait();
+
+  pthread_mutex_lock(&bgzf_pool.mu);
+  bgzf_pool.quit = true;
+  pthread_cond_broadcast(&bgzf_pool.work);
+  pthread_mutex_unlock(&bgzf_pool.mu);
+  for (int32_t i = 0; i < n_threads; i += 1) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+
+  for (int32_t i = 0; i < 2; i += 1) {
+    free(batches[i].in_buf);
+    free(batches[i].out_buf);
+  }
+  free(batches);
+
+  return total;
+}
+
+// sends the whole input behind `fd` to `sink`, inflating it on the way if
+// it is gzip or BGZF; returns the number of bytes the sink received
+static int64_t
+cgr_pump(int fd, cgr_sink_t sink)
+{
+  cgr_reader_t r = {.fd = fd};
+  r.head_len = (int32_t)cgr_read_fd(fd, r.head, BGZF_HEADER_LEN);
+
+  if (cgr_is_bgzf(r.head, r.head_len)) return cgr_pump_bgzf(&r, sink);
+  if (r.head_len >= 2 && r.head[0] == 0x1f && r.head[1] == 0x8b) {
+    return cgr_pump_gzip(&r, sink);
+  }
+
+  return cgr_pump_plain(&r, sink);
+}
+
+// reads everything `fd` has to offer into a malloc'd buffer, for inputs
+// that cannot be mapped (pipes, character devices, compressed files)
+static void
+cgr_read_sample_stream(int fd)
+{
+  data = NULL;
+  data_len = 0;
+  data_cap = 0;
+  data_mapped = false;
+
+  if (cgr_pump(fd, cgr_sink_append) == 0) {
+    printf("ERROR: cgr_read_sample_stream: input is empty\n");
+    exit(1);
+  }
+}
+
+static void
+cgr_read_sample(char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("ERROR: cgr_read_sample: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  struct stat st = {0};
+  if (fstat(fd, &st) < 0) {
+    printf("ERROR: cgr_read_sample: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  uint8_t magic[2] = {0};
+  if (!S_ISREG(st.st_mode)
+    || (pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b)) {
+    cgr_read_sample_stream(fd);
+    close(fd);
+    return;
+  }
+
+  if (st.st_size == 0) {
+    printf("ERROR: cgr_read_sample: file is empty\n");
+    exit(1);
+  }
+
+  // the file is walked front to back exactly once, so let the kernel read
+  // ahead aggressively and drop pages behind us; only the first window is
+  // requested up front so the first frame does not wait for the whole file
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    cgr_read_sample_stream(fd);
+    close(fd);
+    return;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  size_t willneed = st.st_size < SAMPLE_READAHEAD ? st.st_size : SAMPLE_READAHEAD;
+  madvise(map, willneed, MADV_WILLNEED);
+
+  data = map;
+  data_len = (int64_t)st.st_size;
+  data_mapped = true;
+
+  close(fd);
+}
+
+// parses the whole input straight into the packed representation, the
+// text itself is never held in memory
+static void
+cgr_pack_sample(char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("ERROR: cgr_pack_sample: %s\n", strerror(errno));
+    exit(1);
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  parser = (cgr_parser_t){.line_start = true};
+  parse_pack = true;
+  cgr_pump(fd, cgr_sink_parse);
+  parse_pack = false;
+  close(fd);
+
+  if (packed_len == 0) {
+    printf("ERROR: cgr_pack_sample: no bases in input\n");
+    exit(1);
+  }
+
+  data = NULL;
+  data_len = packed_len;
+  data_mapped = false;
+}
+
+static bool
+cgr_is_twobit(char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  uint8_t magic[4] = {0};
+  bool ok = pread(fd, magic, 4, 0) == 4 && cgr_u32(magic) == TWOBIT_MAGIC;
+  close(fd);
+
+  return ok;
+}
+
+static void
+cgr_twobit_fail(char* what)
+{
+  printf("ERROR: cgr_read_twobit: %s\n", what);
+  exit(1);
+}
+
+// maps a .2bit file and indexes the sequences to walk: the one called
+// `seq_name`, or all of them when it is NULL
+static void
+cgr_read_twobit(char* path, char* seq_name)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) cgr_twobit_fail(strerror(errno));
+
+  struct stat st = {0};
+  if (fstat(fd, &st) < 0) cgr_twobit_fail(strerror(errno));
+  if (st.st_size < 16) cgr_twobit_fail("file too short");
+
+  uint8_t* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) cgr_twobit_fail(strerror(errno));
+  close(fd);
+
+  size_t len = st.st_size;
+  uint32_t version = cgr_u32(map + 4);
+  uint32_t count = cgr_u32(map + 8);
+  if (version > 1) cgr_twobit_fail("unsupported version");
+  size_t offset_size = version == 0 ? 4 : 8;
+
+  twobit_seqs = calloc(count > 0 ? count : 1, sizeof(*twobit_seqs));
+  if (twobit_seqs == NULL) cgr_twobit_fail("out of memory");
+
+  int64_t total = 0;
+  size_t at = 16;
+  for (uint32_t i = 0; i < count; i += 1) {
+    if (at + 1 > len) cgr_twobit_fail("truncated index");
+    uint32_t name_len = map[at];
+    if (at + 1 + name_len + offset_size > len) {
+      cgr_twobit_fail("truncated index");
+    }
+    char name[256] = {0};
+    memcpy(name, map + at + 1, name_len);
+    uint64_t offset = 0;
+    memcpy(&offset, map + at + 1 + name_len, offset_size);
+    at += 1 + name_len + offset_size;
+
+    if (seq_name != NULL && strcmp(name, seq_name) != 0) continue;
+
+    if (offset + 8 > len) cgr_twobit_fail("truncated sequence");
+    uint32_t dna_len = cgr_u32(map + offset);
+    uint32_t n_blocks = cgr_u32(map + offset + 4);
+    size_t mask_at = offset + 8 + 8 * (size_t)n_blocks;
+    if (mask_at + 4 > len) cgr_twobit_fail("truncated sequence");
+    uint32_t mask_blocks = cgr_u32(map + mask_at);
+    size_t dna_at = mask_at + 4 + 8 * (size_t)mask_blocks + 4;
+    if (dna_at + (dna_len + 3) / 4 > len) cgr_twobit_fail("truncated sequence");
+
+    // mask blocks only mark soft-masked (lowercase) bases, which walk the
+    // same as uppercase ones
+    cgr_twobit_seq_t* seq = &twobit_seqs[twobit_n_seqs];
+    memcpy(seq->name, name, sizeof(name));
+    seq->start = total;
+    seq->len = dna_len;
+    seq->dna = map + dna_at;
+    seq->n_blocks = n_blocks;
+    seq->n_starts = map + offset + 8;
+    seq->n_sizes = map + offset + 8 + 4 * (size_t)n_blocks;
+    twobit_n_seqs += 1;
+    total += dna_len;
+  }
+
+  if (seq_name != NULL && twobit_n_seqs == 0) {
+    printf("ERROR: cgr_read_twobit: no sequence named %s\n", seq_name);
+    exit(1);
+  }
+  if (total == 0) cgr_twobit_fail("no bases in input");
+
+  madvise(map, len, MADV_SEQUENTIAL);
+
+  twobit_map = map;
+  twobit_map_len = len;
+  data = NULL;
+  data_len = total;
+  data_mapped = false;
+}
+
+static void
+cgr_free_sample(void)
+{
+  if (twobit_map != NULL) munmap(twobit_map, twobit_map_len);
+  free(twobit_seqs);
+  twobit_map = NULL;
+  twobit_map_len = 0;
+  twobit_seqs = NULL;
+  twobit_n_seqs = 0;
+
+  free(packed);
+  free(packed_amb);
+  free(packed_events);
+  packed = NULL;
+  packed_amb = NULL;
+  packed_events = NULL;
+  packed_len = 0;
+  packed_cap = 0;
+  packed_n_events = 0;
+  packed_events_cap = 0;
+
+  free(zoom_offsets);
+  free(zoom_cells);
+  free(zoom_todo);
+  free(zoom_want);
+  zoom_offsets = NULL;
+  zoom_cells = NULL;
+  zoom_todo = NULL;
+  zoom_want = NULL;
+  zoom_cells_len = 0;
+  zoom_cells_cap = 0;
+  zoom_indexed = false;
+
+  if (data_mapped) {
+    munmap(data, data_len);
+  } else {
+    free(data);
+  }
+
+  data = NULL;
+  data_len = 0;
+  data_cap = 0;
+  data_mapped = false;
+}
+
+// walks the input chunk by chunk without ever holding more than a few
+// chunks of it, so inputs larger than RAM can be processed
+static void
+cgr_stream_sample(char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("ERROR: cgr_stream_sample: %s\n", strerror(errno));
+    exit(1);
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  if (cgr_pump(fd, cgr_sink_parse) == 0) {
+    printf("ERROR: cgr_stream_sample: input is empty\n");
+    exit(1);
+  }
+  cgr_walker_flush(&walker);
+
+  close(fd);
+}
+
+// the walk is split across threads in chunks. At ratio 0.5 and in k-mer
+// mode each thread warms up to the start of its chunk (cgr_walk_warmup),
+// then counts its chunk into its own grid.
+//
+// at any other ratio every base is the affine map p -> (1 - r) p + r c, so
+// a chunk as a whole is p -> a p + b with a = (1 - r)^n. each thread first
+// finds the a and b of its chunk, the maps are chained to give every chunk
+// its start, and the chunks are walked from there. float rounding can still
+// put a start an ulp off the sequential walk, so the chunks are then
+// checked in order and the first steps of an off one are walked again from
+// the true start, taking back the cells it counted, until both agree.
+//
+// the grids are summed at the end, each thread adding up its own slice of
+// cells
+#define PARALLEL_FIXUP_MIN 64
+
+typedef struct cgr_parallel_job {
+  int64_t from;
+  int64_t to;
+  int64_t cells;
+  int32_t idx;
+  int64_t* counts;
+  int64_t** all_counts;
+  struct cgr_parallel_job* jobs;
+  pthread_barrier_t* barrier;
+
+  // the chunk as an affine map, restarted when it holds a restart
+  double a;
+  Vector2 b;
+  bool restarted;
+  int64_t bases;
+  int32_t hidden;
+
+  Vector2 start_pos;
+  int32_t start_hidden;
+  Vector2 end_pos;
+  int32_t end_hidden;
+} cgr_parallel_job_t;
+
+static bool
+cgr_parallel_ok(void)
+{
+  return n_threads > 1 && cgr_walk_seekable();
+}
+
+static void
+cgr_parallel_affine(cgr_parallel_job_t* job, cgr_walker_t* w, cgr_parser_t* p)
+{
+  cgr_walker_init(w, job->counts);
+  w->point_pos = Vector2Zero();
+  w->counting = false;
+  cgr_walk_begin(p, job->from);
+  cgr_walk_sample(p, job->from, job->to - job->from);
+
+  job->a = w->restarted ? 0.0 : pow(1.0 - jump_ratio, w->bases);
+  job->b = w->point_pos;
+  job->restarted = w->restarted;
+  job->bases = w->bases;
+  job->hidden = w->hidden;
+
+  pthread_barrier_wait(job->barrier);
+
+  // chains the maps of all chunks before this one onto the center
+  Vector2 pos = grid_center;
+  int32_t hidden = 0;
+  for (int32_t i = 0; i < job->idx; i += 1) {
+    cgr_parallel_job_t* prev = &job->jobs[i];
+    if (prev->restarted) {
+      pos = prev->b;
+      hidden = prev->hidden;
+      continue;
+    }
+    pos.x = prev->a * pos.x + prev->b.x;
+    pos.y = prev->a * pos.y + prev->b.y;
+    hidden = hidden > prev->bases ? hidden - prev->bases : 0;
+  }
+
+  cgr_walker_init(w, job->counts);
+  w->point_pos = pos;
+  w->hidden = hidden;
+  job->start_pos = pos;
+  job->start_hidden = hidden;
+  cgr_walk_begin(p, job->from);
+}
+
+// walks each chunk that did not start where the one before it ended again
+// from its true start, next to its first walk counting backwards, for as
+// long as the two walks differ
+static void
+cgr_parallel_fixup(cgr_parallel_job_t* jobs)
+{
+  for (int32_t i = 1; i < n_threads; i += 1) {
+    cgr_parallel_job_t* job = &jobs[i];
+    cgr_walker_t was, is;
+    cgr_parser_t was_p = {.w = &was};
+    cgr_parser_t is_p = {.w = &is};
+    cgr_walker_init(&was, job->counts);
+    cgr_walker_init(&is, job->counts);
+    was.point_pos = job->start_pos;
+    was.hidden = job->start_hidden;
+    was.weight = -1;
+    is.point_pos = jobs[i - 1].end_pos;
+    is.hidden = jobs[i - 1].end_hidden;
+    cgr_walk_begin(&was_p, job->from);
+    cgr_walk_begin(&is_p, job->from);
+
+    int64_t from = job->from;
+    for (int64_t n = PARALLEL_FIXUP_MIN;; n *= 2) {
+      if (
+        was.point_pos.x == is.point_pos.x && was.point_pos.y == is.point_pos.y
+        && was.hidden == is.hidden
+      ) {
+        break;
+      }
+      if (from == job->to) {
+        job->end_pos = is.point_pos;
+        job->end_hidden = is.hidden;
+        break;
+      }
+
+      if (n > job->to - from) n = job->to - from;
+      cgr_walk_sample(&was_p, from, n);
+      cgr_walk_sample(&is_p, from, n);
+      from += n;
+    }
+  }
+}
+
+static void*
+cgr_parallel_worker(void* arg)
+{
+  cgr_parallel_job_t* job = arg;
+  cgr_walker_t w;
+  cgr_parser_t p = {.w = &w};
+  bool exact = walk_fixed || kmer_k > 0;
+
+  if (exact) {
+    cgr_walk_warmup(&p, job->from, job->counts);
+  } else {
+    cgr_parallel_affine(job, &w, &p);
+  }
+
+  cgr_walk_sample(&p, job->from, job->to - job->from);
+  cgr_walker_flush(&w);
+  cgr_walker_free(&w);
+
+  if (!exact) {
+    job->end_pos = w.point_pos;
+    job->end_hidden = w.hidden;
+    pthread_barrier_wait(job->barrier);
+    if (job->idx == 0) cgr_parallel_fixup(job->jobs);
+  }
+
+  pthread_barrier_wait(job->barrier);
+  int64_t lo = job->cells * job->idx / n_threads;
+  int64_t hi = job->cells * (job->idx + 1) / n_threads;
+  for (int32_t t = 1; t < n_threads; t += 1) {
+    int64_t* src = job->all_counts[t];
+    for (int64_t c = lo; c < hi; c += 1) job->all_counts[0][c] += src[c];
+  }
+  return NULL;
+}
+
+// walks the whole loaded sample on n_threads threads, the first counting
+// straight into the shared grid
+static void
+cgr_walk_parallel(void)
+{
+  int64_t cells = cgr_count_cells_len();
+  cgr_parallel_job_t* jobs = calloc(n_threads, sizeof(*jobs));
+  int64_t** all_counts = calloc(n_threads, sizeof(*all_counts));
+  pthread_t* threads = malloc(sizeof(*threads) * n_threads);
+  pthread_barrier_t barrier;
+  pthread_barrier_init(&barrier, NULL, n_threads);
+
+  all_counts[0] = kmer_k > 0 ? kmer_counts : grid_counts;
+  int64_t prev = 0;
+  for (int32_t i = 0; i < n_threads; i += 1) {
+    if (i > 0) all_counts[i] = cgr_counts_alloc(cells);
+    int64_t to = data_len;
+    if (i < n_threads - 1) {
+      to = cgr_walk_split(data_len * (i + 1) / n_threads);
+    }
+    if (to < prev) to = prev;
+    jobs[i] = (cgr_parallel_job_t){
+      .from = prev,
+      .to = to,
+      .cells = cells,
+      .idx = i,
+      .counts = all_counts[i],
+      .all_counts = all_counts,
+      .jobs = jobs,
+      .barrier = &barrier,
+    };
+    prev = to;
+  }
+
+  for (int32_t i = 0; i < n_threads; i += 1) {
+    if (pthread_create(&threads[i], NULL, cgr_parallel_worker, &jobs[i]) != 0) {
+      printf("ERROR: cgr_walk_parallel: pthread_create failed\n");
+      exit(1);
+    }
+  }
+  for (int32_t i = 0; i < n_threads; i += 1) {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_barrier_destroy(&barrier);
+  for (int32_t i = 1; i < n_threads; i += 1) {
+    cgr_counts_free(all_counts[i], cells);
+  }
+  free(all_counts);
+  free(threads);
+  free(jobs);
+  data_idx = data_len;
+}
+
+static void
+cgr_usage(char* prog)
+{
+  printf("USAGE: %s [options] <file>\n", prog);
+  printf("OPTIONS:\n");
+  printf("  --headless        walk the whole file, export and exit\n");
+  printf("  --image <path>    headless grid image (default: image.png)\n");
+  printf("  --hist <path>     headless grid counts (default: none)\n");
+  printf("  --per-record      headless: one histogram per FASTA record (or\n");
+  printf("                    FASTQ read), all written to --hist (no image)\n");
+  printf("  --stream          headless: read the file in chunks instead of\n");
+  printf("                    loading it, for inputs larger than RAM\n");
+  printf("  --sync            window: walk between frames instead of on a\n");
+  printf("                    separate thread, sized to the refresh rate\n");
+  printf("  --fast            window: with --sync, walk for the whole frame\n");
+  printf("                    without waiting for vsync\n");
+  printf("  --sweep           window: walk every ratio R goes through at once\n");
+  printf("                    so R switches instantly (no zoom)\n");
+  printf("  --kmer <k>        count exact k-mers on a 2^k grid (1 to %d)\n", KMER_MAX);
+  printf("  --grid <n>        grid cells a side, 1 to %d (default: %d)\n", GRID_N_MAX, GRID_N);
+  printf("  --level <l>       headless: write the grid summed 2x2 <l> times\n");
+  printf("                    (default: 0, the full grid)\n");
+  printf("  --ratio <r>       jump ratio, above 0 and at most 1 (default: 0.5,\n");
+  printf("                    or the polygon's own for a protein alphabet)\n");
+  printf("  --alphabet <a>    dna, protein (20 corners) or the reduced dayhoff6\n");
+  printf("                    and murphy10 (default: dna)\n");
+  printf("  --pack            keep the sample 2-bit packed in memory\n");
+  printf("  --min-qual <q>    FASTQ: walk bases with phred+33 quality below\n");
+  printf("                    <q> as N (default: 0, no filtering)\n");
+  printf("  --seq <name>      .2bit: only walk the sequence called <name>\n");
+  printf("  --threads <n>     worker threads (default: all cores)\n");
+  printf("  --simd <level>    scalar, sse4, avx2 or avx512 (default: best the\n");
+  printf("                    cpu supports)\n");
+  printf("  --accum <mode>    counting: direct, split, radix or prefetch\n");
+  printf("                    (default: auto)\n");
+  printf("  --n <policy>      N bases: skip, restart or mask (default: skip)\n");
+  printf("  --iupac <policy>  other IUPAC codes (default: skip)\n");
+  printf("  --other <policy>  any other byte (default: skip)\n");
+}
+
+static void
+cgr_run_headless(
+  char* path, bool stream, bool per_record, char* image_path, char* hist_path
+)
+{
+  if (per_record) {
+    record_out = cgr_open_output(hist_path);
+    // name of the leading record when the file does not start with `>`
+    snprintf(parser.name, sizeof(parser.name), "%s", path);
+    parser.name_len = strlen(parser.name);
+  }
+
+  if (twobit_map != NULL && per_record) {
+    for (int32_t i = 0; i < twobit_n_seqs; i += 1) {
+      cgr_twobit_seq_t* seq = &twobit_seqs[i];
+      cgr_walk_restart(&walker, false);
+      cgr_walk_twobit_seq(&walker, seq, 0, seq->len);
+      cgr_walker_flush(&walker);
+      cgr_write_grid_counts(record_out, seq->name);
+      cgr_clear_grid();
+    }
+    cgr_close_output(record_out);
+    record_out = NULL;
+    return;
+  }
+
+  if (stream && twobit_map == NULL) {
+    cgr_stream_sample(path);
+  } else if (!per_record && cgr_parallel_ok()) {
+    data_vis = true;
+    cgr_walk_parallel();
+  } else {
+    data_vis = true;
+    cgr_vis_step(data_len);
+  }
+
+  if (per_record) {
+    cgr_record_end(&parser);
+    cgr_close_output(record_out);
+    record_out = NULL;
+    return;
+  }
+
+  if (image_path != NULL) cgr_export_grid_image(image_path);
+  if (hist_path != NULL) cgr_export_grid_counts(hist_path, path);
+}
+
+int
+main(int argc, char** argv)
+{
+  char* path = NULL;
+  bool headless = false;
+  bool stream = false;
+  bool sync_walk = false;
+  bool fast_walk = false;
+  bool sweep = false;
+  int32_t grid_size = 0;
+  bool per_record = false;
+  bool pack = false;
+  bool ratio_set = false;
+  char* seq_name = NULL;
+  char* image_path = "image.png";
+  char* hist_path = NULL;
+  cgr_simd_level_t simd_level = cgr_simd_detect();
+
+  for (int32_t i = 1; i < argc; i += 1) {
+    if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (strcmp(argv[i], "--sync") == 0) {
+      sync_walk = true;
+    } else if (strcmp(argv[i], "--fast") == 0) {
+      fast_walk = true;
+    } else if (strcmp(argv[i], "--sweep") == 0) {
+      sweep = true;
+    } else if (strcmp(argv[i], "--stream") == 0) {
+      stream = true;
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      i += 1;
+      n_threads = atoi(argv[i]);
+      if (n_threads < 1) {
+        printf("ERROR: --threads must be at least 1\n");
+        exit(1);
+      }
+    } else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+      i += 1;
+      simd_level = cgr_parse_simd(argv[i]);
+    } else if (strcmp(argv[i], "--accum") == 0 && i + 1 < argc) {
+      i += 1;
+      accum = cgr_parse_accum(argv[i]);
+    } else if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      i += 1;
+      class_policy[CGR_CLASS_N] = cgr_parse_policy(argv[i]);
+    } else if (strcmp(argv[i], "--iupac") == 0 && i + 1 < argc) {
+      i += 1;
+      class_policy[CGR_CLASS_IUPAC] = cgr_parse_policy(argv[i]);
+    } else if (strcmp(argv[i], "--other") == 0 && i + 1 < argc) {
+      i += 1;
+      class_policy[CGR_CLASS_OTHER] = cgr_parse_policy(argv[i]);
+    } else if (strcmp(argv[i], "--min-qual") == 0 && i + 1 < argc) {
+      i += 1;
+      min_qual = atoi(argv[i]);
+    } else if (strcmp(argv[i], "--seq") == 0 && i + 1 < argc) {
+      i += 1;
+      seq_name = argv[i];
+    } else if (strcmp(argv[i], "--kmer") == 0 && i + 1 < argc) {
+      i += 1;
+      kmer_k = atoi(argv[i]);
+      if (kmer_k < 1 || kmer_k > KMER_MAX) {
+        printf("ERROR: --kmer must be between 1 and %d\n", KMER_MAX);
+        exit(1);
+      }
+      grid_n = 1 << kmer_k;
+    } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+      i += 1;
+      grid_size = atoi(argv[i]);
+      if (grid_size < 1 || grid_size > GRID_N_MAX) {
+        printf("ERROR: --grid must be between 1 and %d\n", GRID_N_MAX);
+        exit(1);
+      }
+    } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+      i += 1;
+      grid_level = atoi(argv[i]);
+    } else if (strcmp(argv[i], "--ratio") == 0 && i + 1 < argc) {
+      i += 1;
+      jump_ratio = strtof(argv[i], NULL);
+      ratio_set = true;
+      if (!(jump_ratio > 0.0f && jump_ratio <= 1.0f)) {
+        printf("ERROR: --ratio must be above 0 and at most 1\n");
+        exit(1);
+      }
+    } else if (strcmp(argv[i], "--alphabet") == 0 && i + 1 < argc) {
+      i += 1;
+      alphabet = cgr_parse_alphabet(argv[i]);
+    } else if (strcmp(argv[i], "--pack") == 0) {
+      pack = true;
+    } else if (strcmp(argv[i], "--per-record") == 0) {
+      per_record = true;
+    } else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc) {
+      i += 1;
+      image_path = argv[i];
+    } else if (strcmp(argv[i], "--hist") == 0 && i + 1 < argc) {
+      i += 1;
+      hist_path = argv[i];
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      printf("ERROR: unknown option: %s\n", argv[i]);
+      cgr_usage(argv[0]);
+      exit(1);
+    } else if (path == NULL) {
+      path = argv[i];
+    } else {
+      printf("ERROR: more than one <file> provided\n");
+      cgr_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (path == NULL) {
+    printf("ERROR: <file> not provided\n");
+    cgr_usage(argv[0]);
+    exit(1);
+  }
+
+  if (stream && !headless) {
+    printf("ERROR: --stream requires --headless\n");
+    exit(1);
+  }
+
+  if (sweep && (headless || kmer_k > 0)) {
+    printf("ERROR: --sweep needs the window and cannot be combined with --kmer\n");
+    exit(1);
+  }
+
+  if (fast_walk && !sync_walk) {
+    printf("ERROR: --fast requires --sync\n");
+    exit(1);
+  }
+
+  if (per_record && (!headless || hist_path == NULL)) {
+    printf("ERROR: --per-record requires --headless and --hist\n");
+    exit(1);
+  }
 
-  SetConfigFlags(FLAG_VSYNC_HINT);
+  if (grid_size > 0) {
+    if (kmer_k > 0) {
+      printf("ERROR: --grid cannot be combined with --kmer\n");
+      exit(1);
+    }
+    grid_n = grid_size;
+  }
+
+  if (kmer_k > 0 && jump_ratio != 0.5f) {
+    printf("ERROR: --kmer walks at ratio 0.5 only\n");
+    exit(1);
+  }
+
+  if (alphabet != ALPHABET_DNA) {
+    if (kmer_k > 0 || pack) {
+      printf("ERROR: protein alphabets cannot be combined with --kmer or --pack\n");
+      exit(1);
+    }
+    if (!ratio_set) jump_ratio = cgr_polygon_ratio(alphabet_n_corners[alphabet]);
+  }
+
+  if (n_threads == 0) {
+    n_threads = (int32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+  }
+
+  cgr_init_corner_map();
+  cgr_init_simd(simd_level);
+  cgr_init_accum();
+  cgr_alloc_grid();
+
+  if (grid_level > 0 && !headless) {
+    printf("ERROR: --level requires --headless\n");
+    exit(1);
+  }
+  if (grid_level < 0 || grid_level >= pyramid_levels) {
+    printf("ERROR: --level must be between 0 and %d\n", pyramid_levels - 1);
+    exit(1);
+  }
+
+  if (pack && (stream || per_record)) {
+    printf("ERROR: --pack cannot be combined with --stream or --per-record\n");
+    exit(1);
+  }
+
+  // .2bit is already packed and indexed, it is always mapped and walked
+  // in place whatever the loading options
+  cgr_init_twobit_byte();
+  if (cgr_is_twobit(path)) {
+    if (alphabet != ALPHABET_DNA) {
+      printf("ERROR: .2bit files only hold DNA\n");
+      exit(1);
+    }
+    cgr_read_twobit(path, seq_name);
+  } else if (seq_name != NULL) {
+    printf("ERROR: --seq only applies to .2bit files\n");
+    exit(1);
+  } else if (pack) {
+    cgr_pack_sample(path);
+  } else if (!stream) {
+    cgr_read_sample(path);
+  }
+  cgr_init();
+
+  if (headless) {
+    SetTraceLogLevel(LOG_WARNING);
+    cgr_run_headless(path, stream, per_record, image_path, hist_path);
+    cgr_free_sample();
+    return 0;
+  }
+
+  if (!fast_walk) SetConfigFlags(FLAG_VSYNC_HINT);
   InitWindow(WINDOW_W, WINDOW_H, "CGR");
+  cgr_load_grid_texture();
+  cgr_alloc_snapshots();
+  cgr_clear_grid();
+  if (sweep) cgr_init_sweep();
+  if (!sync_walk) cgr_start_producer();
+
+  int32_t refresh = GetMonitorRefreshRate(GetCurrentMonitor());
+  double frame_s = 1.0 / (refresh > 0 ? refresh : 60);
+  double draw_s = 0.0;
 
   while (!WindowShouldClose()) {
     if (IsKeyPressed(KEY_SPACE)) {
@@ -285,25 +3883,52 @@ main(int argc, char** argv)
     if (IsKeyPressed(KEY_E)) {
       cgr_export_screen();
     }
-    if (IsKeyPressed(KEY_R)) {
+    if (IsKeyPressed(KEY_R) && sweep_n > 0) {
+      if (!sync_walk) cgr_stop_producer();
+      cgr_sweep_next();
+      if (!sync_walk) cgr_start_producer();
+    } else if (IsKeyPressed(KEY_R) && kmer_k == 0) {
       if (jump_ratio < 1.0f) {
-        jump_ratio += 0.1f;
+        if (!sync_walk) cgr_stop_producer();
+        jump_ratio = fminf(jump_ratio + 0.1f, 1.0f);
         cgr_init();
+        if (!sync_walk) cgr_start_producer();
       }
     }
 
+    int32_t depth;
+    int64_t zoom_to_x, zoom_to_y;
+    if (cgr_zoom_ok() && cgr_zoom_input(&depth, &zoom_to_x, &zoom_to_y)) {
+      if (!sync_walk) cgr_stop_producer();
+      cgr_zoom_to(depth, zoom_to_x, zoom_to_y);
+      if (!sync_walk) cgr_start_producer();
+    }
+
+    if (sync_walk) {
+      cgr_sync_walk(frame_s, draw_s, fast_walk);
+      cgr_publish();
+    }
+    cgr_snapshot_t* snap = cgr_take_snapshot();
+
+    // drawing is timed up to the buffer swap, which waits for vsync
+    double draw_start = GetTime();
     BeginDrawing();
     ClearBackground(RAYWHITE);
 
-    cgr_vis_step();
-    cgr_draw_grid();
+    cgr_draw_grid(snap);
     cgr_draw_corners();
-    cgr_draw_debug_info();
+    cgr_draw_debug_info(snap);
+    draw_s = GetTime() - draw_start;
 
     EndDrawing();
   }
 
+  if (!sync_walk) cgr_stop_producer();
+  cgr_free_sweep();
+  cgr_unload_grid_texture();
+  cgr_free_snapshots();
   CloseWindow();
+  cgr_free_sample();
 
   return 0;
 }
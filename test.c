@@ -0,0 +1,143 @@
+// checks on the walk that the headless outputs cannot show: main.c is
+// built in with its main renamed, and each case runs in its own process
+// since the walk state is all globals
+#define main cgr_main
+#include "main.c"
+#undef main
+
+#include <sys/wait.h>
+
+static char* test_path = NULL;
+
+// a sample file with `seq` as its only record
+static void
+test_sample(char* seq, int64_t repeat)
+{
+  static char path[32];
+  snprintf(path, sizeof(path), "/tmp/cgr-test-XXXXXX");
+  int fd = mkstemp(path);
+  FILE* f = fdopen(fd, "w");
+  fprintf(f, ">test\n");
+  for (int64_t i = 0; i < repeat; i += 1) fputs(seq, f);
+  fputc('\n', f);
+  fclose(f);
+  test_path = path;
+}
+
+// as main sets things up for the window, before the first frame
+static void
+test_window_setup(void)
+{
+  cgr_init_corner_map();
+  cgr_init_simd(cgr_simd_detect());
+  cgr_init_accum();
+  cgr_alloc_grid();
+  cgr_read_sample(test_path);
+  cgr_init();
+  cgr_alloc_snapshots();
+  cgr_clear_grid();
+  memset(grid_dirty, 0, sizeof(*grid_dirty) * ((grid_spans + 63) / 64));
+}
+
+// every non-zero cell must be in a span marked dirty and the walker must
+// know the largest count, or the window never shows it
+static bool
+test_accum_dirty(int32_t mode)
+{
+  accum = mode;
+  test_window_setup();
+  data_vis = true;
+  cgr_vis_step(data_len);
+
+  int64_t* counts = walker.counts;
+  int64_t cells = cgr_count_cells_len();
+  int64_t max = 0;
+  int64_t clean = 0;
+  for (int64_t c = 0; c < cells; c += 1) {
+    if (counts[c] > max) max = counts[c];
+    int64_t span = c >> DIRTY_SHIFT;
+    if (counts[c] != 0 && !(grid_dirty[span / 64] >> (span % 64) & 1)) clean += 1;
+  }
+
+  if (clean > 0 || walker.max != max || max == 0) {
+    printf("  %" PRId64 " counted cells in clean spans, max %" PRId64 " of %" PRId64 "\n", clean, walker.max, max);
+    return false;
+  }
+  return true;
+}
+
+static int64_t test_blocks = 0;
+
+static bool
+test_translate(uint8_t* buf, uint32_t* mx, uint32_t* my)
+{
+  test_blocks += 1;
+  return cgr_translate_scalar(buf, mx, my);
+}
+
+// k-mers walk in SIMD blocks again once k bases follow an N, whether the N
+// restarts the walk or masks it
+static int64_t
+test_kmer_blocks(uint8_t policy)
+{
+  class_policy[CGR_CLASS_N] = policy;
+  cgr_init_corner_map();
+  cgr_init_simd(CGR_SIMD_SCALAR);
+  simd.translate = test_translate;
+  cgr_init();
+  data_vis = true;
+  test_blocks = 0;
+  cgr_vis_step(data_len);
+  return test_blocks;
+}
+
+static bool
+test_kmer_mask_blocks(int32_t k)
+{
+  kmer_k = k;
+  grid_n = 1 << k;
+  cgr_init_accum();
+  cgr_alloc_grid();
+  cgr_read_sample(test_path);
+
+  int64_t restart = test_kmer_blocks(CGR_POLICY_RESTART);
+  int64_t mask = test_kmer_blocks(CGR_POLICY_MASK);
+  if (mask != restart || mask == 0) {
+    printf("  %" PRId64 " blocks with mask, %" PRId64 " with restart\n", mask, restart);
+    return false;
+  }
+  return true;
+}
+
+static int32_t test_failed = 0;
+
+static void
+test_run(char* name, char* variant, bool (*fn)(int32_t), int32_t arg)
+{
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) exit(fn(arg) ? 0 : 1);
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  printf("%s %s %s\n", ok ? "ok  " : "FAIL", name, variant);
+  if (!ok) test_failed += 1;
+}
+
+int
+main(void)
+{
+  test_sample("ACGT", 100000);
+  for (cgr_accum_t mode = CGR_ACCUM_DIRECT; mode < CGR_ACCUM_COUNT; mode += 1) {
+    test_run("accum dirty spans", accum_names[mode], test_accum_dirty, mode);
+  }
+  unlink(test_path);
+
+  test_sample("ACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAN", 1000);
+  test_run("kmer blocks after masked N", "k 4", test_kmer_mask_blocks, 4);
+  test_run("kmer blocks after masked N", "k 12", test_kmer_mask_blocks, 12);
+  unlink(test_path);
+
+  return test_failed > 0;
+}
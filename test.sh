@@ -0,0 +1,18 @@
+#!/bin/bash
+
+set -xeuo pipefail
+
+gcc \
+  -Wall \
+  -Wextra \
+  -O2 \
+  -I./raylib-5.5_linux_amd64/include \
+  -o test \
+  test.c \
+  -L./raylib-5.5_linux_amd64/lib \
+  -lraylib \
+  -lz \
+  -lpthread \
+  -lm
+
+LD_LIBRARY_PATH=./raylib-5.5_linux_amd64/lib ./test